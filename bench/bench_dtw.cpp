@@ -0,0 +1,217 @@
+// Benchmark for the draft DTW aligner. It is built against draft/, whose
+// NoteEvent differs from src/, so it is a separate binary.
+//
+//   nnote-dtw-bench [notes] [iterations] [report.json]
+//   nnote-dtw-bench --fastdtw-error [radius]
+//   nnote-dtw-bench --follow reference.mid performance.mid [window] [speed]
+#include "bench_support.h"
+#include "synthetic_corpus.h"
+#include "dtw_aligner.h"
+#include "midi_io.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // DTWAligner logs to stdout when constructed; keep that out of the JSON.
+    class QuietStdout {
+    public:
+        QuietStdout() : saved(std::cout.rdbuf(nullptr)) {}
+        ~QuietStdout() { std::cout.rdbuf(saved); }
+
+    private:
+        std::streambuf* saved;
+    };
+
+    // One row of the FastDTW accuracy report: exact vs approximate alignment
+    // of one reference/performance pair.
+    struct FastDTWErrorSample {
+        size_t notes;
+        double exact_cost;
+        double fast_cost;
+        double relative_error;
+        double exact_seconds;
+        double fast_seconds;
+    };
+
+    FastDTWErrorSample measure_fastdtw_error(const NoteSequence& ref, const NoteSequence& perf,
+                                             double bpm, int radius) {
+        using clock = std::chrono::steady_clock;
+        QuietStdout quiet;
+        DTWAligner aligner(ref, perf, bpm);
+
+        auto started = clock::now();
+        WarpingPath exact = aligner.align_piece();
+        auto exact_done = clock::now();
+        WarpingPath fast = aligner.align_piece_fast(radius);
+        auto fast_done = clock::now();
+
+        FastDTWErrorSample sample;
+        sample.notes = ref.size();
+        sample.exact_cost = exact.cost;
+        sample.fast_cost = fast.cost;
+        sample.relative_error = exact.cost > 0.0 ? (fast.cost - exact.cost) / exact.cost : 0.0;
+        sample.exact_seconds = std::chrono::duration<double>(exact_done - started).count();
+        sample.fast_seconds = std::chrono::duration<double>(fast_done - exact_done).count();
+        return sample;
+    }
+
+    // Synthetic pairs of 250 to 2000 notes with wrong notes and up to 10%
+    // tempo drift, written through the corpus generator and read back.
+    int report_fastdtw_error(int radius) {
+        fs::path dir = fs::temp_directory_path() / "nnote-bench";
+        fs::create_directories(dir);
+        const std::string ref_path = (dir / "fastdtw_ref.mid").string();
+        const std::string perf_path = (dir / "fastdtw_perf.mid").string();
+
+        std::vector<FastDTWErrorSample> samples;
+        for (int notes : {250, 500, 1000, 2000}) {
+            CorpusSpec spec;
+            spec.notes = notes;
+            spec.wrong_note_rate = 0.05;
+            spec.tempo_drift = 0.1;
+            SyntheticCorpus::write_pair(spec, ref_path, perf_path);
+
+            const NoteSequence ref(MIDIIO::parse_midi(ref_path));
+            const NoteSequence perf(MIDIIO::parse_midi(perf_path));
+            samples.push_back(measure_fastdtw_error(ref, perf, MIDIIO::extract_bpm(ref_path), radius));
+        }
+        std::cout << "{\n  \"suite\": \"fastdtw_error\",\n  \"radius\": " << radius
+                  << ",\n  \"samples\": [\n" << std::setprecision(6);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const auto& s = samples[i];
+            std::cout << "    {\"notes\": " << s.notes
+                      << ", \"exact_cost\": " << s.exact_cost
+                      << ", \"fast_cost\": " << s.fast_cost
+                      << ", \"relative_error\": " << s.relative_error
+                      << ", \"exact_seconds\": " << s.exact_seconds
+                      << ", \"fast_seconds\": " << s.fast_seconds << "}"
+                      << (i + 1 < samples.size() ? ",\n" : "\n");
+        }
+        std::cout << "  ]\n}\n";
+        return 0;
+    }
+
+    // Replays a recorded performance into the score follower, releasing each
+    // note at its onset (scaled by `speed`). Per-note positions go to stderr,
+    // the latency summary to stdout. `response` is measured from the note's
+    // scheduled arrival, so it also includes wake-up jitter.
+    int replay_follow(const std::string& ref_path, const std::string& perf_path, int window, double speed) {
+        using Clock = std::chrono::steady_clock;
+        const std::vector<NoteEvent> ref = MIDIIO::parse_midi(ref_path);
+        std::vector<NoteEvent> perf = MIDIIO::parse_midi(perf_path);
+        std::stable_sort(perf.begin(), perf.end(),
+            [](const NoteEvent& a, const NoteEvent& b) { return a.start < b.start; });
+        if (perf.empty()) {
+            throw std::runtime_error("No notes in performance: " + perf_path);
+        }
+
+        if (speed <= 0.0) {
+            throw std::runtime_error("Replay speed must be positive");
+        }
+
+        OnlineDTWFollower follower(NoteSequence(ref), window);
+        std::vector<long long> latency_ns;
+        latency_ns.reserve(perf.size());
+        std::chrono::nanoseconds max_response{0};
+        const double first = perf.front().start;
+        const Clock::time_point t0 = Clock::now();
+        for (const auto& note : perf) {
+            auto due = t0 + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>((note.start - first) / speed));
+            std::this_thread::sleep_until(due);
+            FollowPosition pos = follower.push(note);
+            max_response = std::max(max_response,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - due));
+            latency_ns.push_back(pos.latency.count());
+            std::cerr << pos.perf_index << '\t' << pos.ref_index << '\t' << pos.latency.count() << "\n";
+        }
+
+        std::vector<long long> sorted = latency_ns;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0.0;
+        for (long long v : sorted) mean += v;
+        mean /= sorted.size();
+        const long long p99 = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+
+        std::cout << "{\n  \"suite\": \"follow\",\n"
+                  << "  \"ref_notes\": " << ref.size() << ",\n"
+                  << "  \"perf_notes\": " << perf.size() << ",\n"
+                  << "  \"window\": " << window << ",\n"
+                  << "  \"speed\": " << speed << ",\n"
+                  << "  \"final_ref_index\": " << follower.position() << ",\n"
+                  << "  \"mean_latency_ns\": " << static_cast<long long>(mean) << ",\n"
+                  << "  \"p99_latency_ns\": " << p99 << ",\n"
+                  << "  \"max_latency_ns\": " << follower.max_latency().count() << ",\n"
+                  << "  \"max_response_ns\": " << max_response.count() << "\n}\n";
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        if (argc >= 2 && std::string(argv[1]) == "--fastdtw-error") {
+            return report_fastdtw_error(argc >= 3 ? std::stoi(argv[2]) : 1);
+        }
+        if (argc >= 4 && std::string(argv[1]) == "--follow") {
+            return replay_follow(argv[2], argv[3],
+                                 argc >= 5 ? std::stoi(argv[4]) : 64,
+                                 argc >= 6 ? std::stod(argv[5]) : 1.0);
+        }
+
+        const int notes = argc >= 2 ? std::stoi(argv[1]) : 1000;
+        const int iterations = argc >= 3 ? std::stoi(argv[2]) : 3;
+
+        fs::path dir = fs::temp_directory_path() / "nnote-bench";
+        fs::create_directories(dir);
+        const std::string ref_path = (dir / "dtw_ref.mid").string();
+        const std::string perf_path = (dir / "dtw_perf.mid").string();
+
+        CorpusSpec spec;
+        spec.notes = notes;
+        SyntheticCorpus::write_pair(spec, ref_path, perf_path);
+
+        const NoteSequence ref(MIDIIO::parse_midi(ref_path));
+        const NoteSequence perf(MIDIIO::parse_midi(perf_path));
+        const double bpm = MIDIIO::extract_bpm(ref_path);
+
+        std::vector<Bench::Result> results;
+        {
+            QuietStdout quiet;
+            results.push_back(Bench::measure("dtw_align_notes", ref.size() + perf.size(), iterations, [&] {
+                DTWAligner aligner(ref, perf, bpm);
+                aligner.align_notes();
+            }));
+            results.push_back(Bench::measure("dtw_align_piece_banded", ref.size() + perf.size(), iterations, [&] {
+                DTWAligner aligner(ref, perf, bpm, false, DTWConstraint::SakoeChiba);
+                aligner.align_piece();
+            }));
+            results.push_back(Bench::measure("dtw_align_piece_fast", ref.size() + perf.size(), iterations, [&] {
+                DTWAligner aligner(ref, perf, bpm);
+                aligner.align_piece_fast();
+            }));
+        }
+
+        std::ofstream report_file;
+        if (argc >= 4) {
+            report_file.open(argv[3]);
+            if (!report_file) {
+                throw std::runtime_error("Failed to open report: " + std::string(argv[3]));
+            }
+        }
+        std::ostream& report = argc >= 4 ? report_file : std::cout;
+        Bench::write_json(report, {{"suite", "dtw"}}, results);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "\n[Fatal Error] " << e.what() << "\n";
+        return 1;
+    }
+}
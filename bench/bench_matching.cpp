@@ -0,0 +1,104 @@
+// Benchmarks for the src/ pipeline: SMF parsing, exact and fallback
+// matching, raw MidiFile I/O and segment export. Prints a JSON report.
+//
+//   nnote-bench [notes] [iterations] [report.json]
+//   nnote-bench --corpus <dir> <pairs> [notes] [wrong_note_rate] [tempo_drift]
+#include "bench_support.h"
+#include "synthetic_corpus.h"
+#include "interval_kernels.h"
+#include "midi_io.h"
+#include "similarity_calculator.h"
+#include "MidiFile.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char* argv[]) {
+    try {
+        if (argc >= 4 && std::string(argv[1]) == "--corpus") {
+            CorpusSpec spec;
+            if (argc >= 5) spec.notes = std::stoi(argv[4]);
+            if (argc >= 6) spec.wrong_note_rate = std::stod(argv[5]);
+            if (argc >= 7) spec.tempo_drift = std::stod(argv[6]);
+            SyntheticCorpus::write_corpus(spec, std::stoi(argv[3]), argv[2]);
+            return 0;
+        }
+
+        const int notes = argc >= 2 ? std::stoi(argv[1]) : 2000;
+        const int iterations = argc >= 3 ? std::stoi(argv[2]) : 5;
+
+        fs::path dir = fs::temp_directory_path() / "nnote-bench";
+        fs::create_directories(dir);
+        const std::string ref_path = (dir / "ref.mid").string();
+        const std::string close_path = (dir / "perf_close.mid").string();
+        const std::string far_path = (dir / "perf_far.mid").string();
+        const std::string out_path = (dir / "out.mid").string();
+
+        CorpusSpec spec;
+        spec.notes = notes;
+        SyntheticCorpus::write_pair(spec, ref_path, close_path);
+        // Half the notes wrong leaves no exact run long enough to score 90%,
+        // so matching goes through the duration fallback.
+        spec.wrong_note_rate = 0.5;
+        SyntheticCorpus::write_pair(spec, (dir / "ref_far.mid").string(), far_path);
+
+        const NoteSequence ref = MIDIIO::parse_midi_sequence(ref_path);
+        const NoteSequence close = MIDIIO::parse_midi_sequence(close_path);
+        const NoteSequence far = MIDIIO::parse_midi_sequence(far_path);
+        const std::vector<NoteEvent> ref_events = ref.to_events();
+
+        std::vector<Bench::Result> results;
+        results.push_back(Bench::measure("parse_midi", ref.size(), iterations, [&] {
+            MIDIIO::parse_midi(ref_path);
+        }));
+        results.push_back(Bench::measure("midifile_read", ref.size(), iterations, [&] {
+            smf::MidiFile midi;
+            midi.read(ref_path);
+        }));
+        smf::MidiFile loaded;
+        loaded.read(ref_path);
+        results.push_back(Bench::measure("midifile_write", ref.size(), iterations, [&] {
+            loaded.write(out_path);
+        }));
+
+        bool exact_fallback = false;
+        results.push_back(Bench::measure("find_similar_segments_exact", ref.size() + close.size(), iterations, [&] {
+            SimilarityCalculator calculator(ref, close);
+            calculator.find_similar_segments(70.0);
+            exact_fallback = calculator.was_fallback_used();
+        }));
+        bool far_fallback = false;
+        results.push_back(Bench::measure("find_similar_segments_fallback", ref.size() + far.size(), iterations, [&] {
+            SimilarityCalculator calculator(ref, far);
+            calculator.find_similar_segments(70.0);
+            far_fallback = calculator.was_fallback_used();
+        }));
+
+        results.push_back(Bench::measure("save_segment_to_midi", ref_events.size(), iterations, [&] {
+            MIDIIO::save_segment_to_midi(ref_events, out_path);
+        }));
+
+        std::ofstream report_file;
+        if (argc >= 4) {
+            report_file.open(argv[3]);
+            if (!report_file) {
+                throw std::runtime_error("Failed to open report: " + std::string(argv[3]));
+            }
+        }
+        std::ostream& report = argc >= 4 ? report_file : std::cout;
+        Bench::write_json(report, {
+            {"suite", "matching"},
+            {"interval_kernel", IntervalKernels::kernel_name()},
+            {"exact_path_fallback", exact_fallback ? "yes" : "no"},
+            {"fallback_path_fallback", far_fallback ? "yes" : "no"},
+        }, results);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "\n[Fatal Error] " << e.what() << "\n";
+        return 1;
+    }
+}
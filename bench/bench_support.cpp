@@ -0,0 +1,132 @@
+#include "bench_support.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+    std::atomic<size_t> allocations{0};
+    std::atomic<size_t> bytes{0};
+
+    std::string escape(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace Bench {
+    size_t allocation_count() {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+    size_t allocated_bytes() {
+        return bytes.load(std::memory_order_relaxed);
+    }
+
+    size_t peak_rss_kb() {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return counters.PeakWorkingSetSize / 1024;
+        }
+        return 0;
+#else
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+        return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+    }
+
+    Result measure(const std::string& name, size_t notes, int iterations,
+                   const std::function<void()>& body) {
+        if (iterations < 1) {
+            throw std::runtime_error("Iterations must be positive: " + name);
+        }
+        body();
+
+        Result result;
+        result.name = name;
+        result.notes = notes;
+        result.iterations = iterations;
+
+        const size_t allocations_before = allocation_count();
+        const size_t bytes_before = allocated_bytes();
+        double total_ns = 0.0;
+        double min_ns = std::numeric_limits<double>::max();
+        for (int i = 0; i < iterations; ++i) {
+            auto started = std::chrono::steady_clock::now();
+            body();
+            double ns = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - started).count();
+            total_ns += ns;
+            min_ns = std::min(min_ns, ns);
+        }
+
+        const double per_note = notes > 0 ? 1.0 / notes : 1.0;
+        result.mean_ns_per_note = total_ns / iterations * per_note;
+        result.min_ns_per_note = min_ns * per_note;
+        result.allocations_per_iteration =
+            static_cast<double>(allocation_count() - allocations_before) / iterations;
+        result.bytes_per_iteration =
+            static_cast<double>(allocated_bytes() - bytes_before) / iterations;
+        return result;
+    }
+
+    void write_json(std::ostream& out,
+                    const std::vector<std::pair<std::string, std::string>>& context,
+                    const std::vector<Result>& results) {
+        out << "{\n";
+        for (const auto& [key, value] : context) {
+            out << "  \"" << escape(key) << "\": \"" << escape(value) << "\",\n";
+        }
+        out << "  \"peak_rss_kb\": " << peak_rss_kb() << ",\n"
+            << "  \"benchmarks\": [\n" << std::fixed << std::setprecision(1);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            out << "    {\"name\": \"" << escape(r.name) << "\""
+                << ", \"notes\": " << r.notes
+                << ", \"iterations\": " << r.iterations
+                << ", \"mean_ns_per_note\": " << r.mean_ns_per_note
+                << ", \"min_ns_per_note\": " << r.min_ns_per_note
+                << ", \"allocations_per_iteration\": " << r.allocations_per_iteration
+                << ", \"bytes_per_iteration\": " << r.bytes_per_iteration << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Timing, allocation counting and peak-RSS sampling for the benchmark
+// binaries. Linking bench_support.cpp replaces the global operator new, so
+// every heap allocation in the process is counted.
+namespace Bench {
+    struct Result {
+        std::string name;
+        size_t notes = 0;
+        int iterations = 0;
+        double mean_ns_per_note = 0.0;
+        double min_ns_per_note = 0.0;
+        double allocations_per_iteration = 0.0;
+        double bytes_per_iteration = 0.0;
+    };
+
+    size_t allocation_count();
+    size_t allocated_bytes();
+    // Peak resident set size of the process so far, in kilobytes.
+    size_t peak_rss_kb();
+
+    // Runs `body` once untimed, then `iterations` timed times. `notes` is the
+    // work size each run is normalized by. Throws if `iterations` is below 1.
+    Result measure(const std::string& name, size_t notes, int iterations,
+                   const std::function<void()>& body);
+
+    // One JSON object: the context fields as strings, the peak RSS and one
+    // entry per result.
+    void write_json(std::ostream& out,
+                    const std::vector<std::pair<std::string, std::string>>& context,
+                    const std::vector<Result>& results);
+}
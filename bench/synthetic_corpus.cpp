@@ -0,0 +1,88 @@
+#include "synthetic_corpus.h"
+#include "MidiFile.h"
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    constexpr int ticks_per_quarter = 480;
+    // Tempo is re-drawn every this many notes in the performance.
+    constexpr int tempo_block = 16;
+
+    struct SyntheticNote {
+        int pitch;
+        int duration_ticks;
+    };
+
+    void write_notes(const std::vector<SyntheticNote>& notes,
+                     const std::vector<double>& block_bpm,
+                     const std::string& path) {
+        smf::MidiFile midi;
+        midi.setTicksPerQuarterNote(ticks_per_quarter);
+        midi.addTrack(1);
+        int tick = 0;
+        for (size_t i = 0; i < notes.size(); ++i) {
+            if (i % tempo_block == 0) {
+                midi.addTempo(0, tick, block_bpm[i / tempo_block]);
+            }
+            midi.addNoteOn(1, tick, 0, notes[i].pitch, 90);
+            midi.addNoteOff(1, tick + notes[i].duration_ticks, 0, notes[i].pitch);
+            tick += notes[i].duration_ticks;
+        }
+        midi.sortTracks();
+        if (!midi.write(path)) {
+            throw std::runtime_error("Failed to write MIDI file: " + path);
+        }
+    }
+}
+
+namespace SyntheticCorpus {
+    void write_pair(const CorpusSpec& spec, const std::string& ref_path, const std::string& perf_path) {
+        std::mt19937 rng(spec.seed);
+        std::uniform_int_distribution<int> step(-4, 4);
+        std::uniform_int_distribution<int> length(0, 3);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        const int quarter_fractions[] = {ticks_per_quarter / 4, ticks_per_quarter / 2,
+                                         ticks_per_quarter, ticks_per_quarter * 2};
+
+        std::vector<SyntheticNote> reference;
+        reference.reserve(spec.notes);
+        int pitch = 60;
+        for (int i = 0; i < spec.notes; ++i) {
+            pitch = std::clamp(pitch + step(rng), 36, 96);
+            reference.push_back({pitch, quarter_fractions[length(rng)]});
+        }
+
+        std::vector<SyntheticNote> performance = reference;
+        for (auto& note : performance) {
+            if (unit(rng) < spec.wrong_note_rate) {
+                int offset = 1 + static_cast<int>(unit(rng) * 3);
+                note.pitch = std::clamp(note.pitch + (unit(rng) < 0.5 ? -offset : offset), 0, 127);
+            }
+        }
+
+        const size_t blocks = (reference.size() + tempo_block - 1) / tempo_block;
+        std::vector<double> ref_bpm(blocks, spec.bpm);
+        std::vector<double> perf_bpm(blocks);
+        for (auto& bpm : perf_bpm) {
+            bpm = spec.bpm * (1.0 + spec.tempo_drift * (2.0 * unit(rng) - 1.0));
+        }
+
+        write_notes(reference, ref_bpm, ref_path);
+        write_notes(performance, perf_bpm, perf_path);
+    }
+
+    void write_corpus(const CorpusSpec& spec, int count, const std::string& directory) {
+        std::filesystem::create_directories(directory);
+        for (int i = 0; i < count; ++i) {
+            CorpusSpec pair_spec = spec;
+            pair_spec.seed = spec.seed + i;
+            std::filesystem::path dir(directory);
+            write_pair(pair_spec,
+                       (dir / ("ref_" + std::to_string(i) + ".mid")).string(),
+                       (dir / ("perf_" + std::to_string(i) + ".mid")).string());
+        }
+    }
+}
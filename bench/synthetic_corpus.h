@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Writes reference/performance MIDI pairs with controlled properties. The
+// reference is a random melodic walk; the performance replays it with some
+// notes replaced by wrong pitches and the tempo wandering around the
+// reference tempo.
+struct CorpusSpec {
+    int notes = 2000;
+    // Fraction of performance notes played at a wrong pitch.
+    double wrong_note_rate = 0.02;
+    // Largest relative deviation of the performance tempo, e.g. 0.05 = 5%.
+    double tempo_drift = 0.05;
+    double bpm = 120.0;
+    uint32_t seed = 1;
+};
+
+namespace SyntheticCorpus {
+    void write_pair(const CorpusSpec& spec, const std::string& ref_path, const std::string& perf_path);
+
+    // `count` pairs as ref_<i>.mid / perf_<i>.mid in `directory`, with seeds
+    // spec.seed, spec.seed + 1, ...
+    void write_corpus(const CorpusSpec& spec, int count, const std::string& directory);
+}
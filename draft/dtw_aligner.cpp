@@ -1,27 +1,115 @@
 #include "dtw_aligner.h"
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <climits>
+#include <stdexcept>
 #include <limits>
 #include <numeric>
 #include <unordered_map>
 #include <iostream> 
+#include <tuple>
+
+namespace {
+    double feature_distance(const std::vector<double>& a, const std::vector<double>& b) {
+        double sum = 0.0;
+        for (size_t k = 0; k < a.size(); ++k) {
+            double d = a[k] - b[k];
+            sum += d * d;
+        }
+        return std::sqrt(sum);
+    }
+
+    // Rows and columns are 1-based as in the DTW grid; index 0 is unused.
+    void sakoe_chiba_band(int n, int m, int radius, std::vector<int>& lo, std::vector<int>& hi) {
+        lo.assign(n + 1, 1);
+        hi.assign(n + 1, m);
+        for (int i = 1; i <= n; ++i) {
+            double center = (n == 1) ? 1.0 : 1.0 + static_cast<double>(i - 1) * (m - 1) / (n - 1);
+            int c = static_cast<int>(std::lround(center));
+            lo[i] = std::max(1, c - radius);
+            hi[i] = std::min(m, c + radius);
+        }
+    }
+
+    void itakura_band(int n, int m, double max_slope, std::vector<int>& lo, std::vector<int>& hi) {
+        lo.assign(n + 1, 1);
+        hi.assign(n + 1, m);
+        if (n == 1 || m == 1) return;
+        const double x_end = n - 1;
+        const double y_end = m - 1;
+        for (int i = 1; i <= n; ++i) {
+            double x = i - 1;
+            double y_min = std::max(x / max_slope, y_end - max_slope * (x_end - x));
+            double y_max = std::min(max_slope * x, y_end - (x_end - x) / max_slope);
+            if (y_min > y_max) {
+                // Slope limit cannot reach (n, m); keep the straight line.
+                y_min = y_max = x * y_end / x_end;
+            }
+            lo[i] = std::clamp(static_cast<int>(std::ceil(y_min - 1e-9)) + 1, 1, m);
+            hi[i] = std::clamp(static_cast<int>(std::floor(y_max + 1e-9)) + 1, 1, m);
+        }
+    }
+
+    // Averages adjacent pairs of feature rows; an odd last row is kept.
+    std::vector<std::vector<double>> coarsen(const std::vector<std::vector<double>>& seq) {
+        std::vector<std::vector<double>> coarse;
+        coarse.reserve((seq.size() + 1) / 2);
+        for (size_t k = 0; k < seq.size(); k += 2) {
+            if (k + 1 == seq.size()) {
+                coarse.push_back(seq[k]);
+                continue;
+            }
+            std::vector<double> mean(seq[k].size());
+            for (size_t f = 0; f < mean.size(); ++f) {
+                mean[f] = 0.5 * (seq[k][f] + seq[k + 1][f]);
+            }
+            coarse.push_back(std::move(mean));
+        }
+        return coarse;
+    }
+
+    // Widens a band just enough that (1, 1) connects to (n, m): each row must
+    // start no later than one column after the previous row ends, and end no
+    // earlier than the previous row starts.
+    void connect_band(int m, std::vector<int>& lo, std::vector<int>& hi) {
+        const int n = static_cast<int>(lo.size()) - 1;
+        if (n < 1) return;
+        lo[1] = 1;
+        hi[n] = m;
+        for (int i = 1; i <= n; ++i) {
+            lo[i] = std::clamp(lo[i], 1, m);
+            hi[i] = std::clamp(hi[i], lo[i], m);
+            if (i > 1) {
+                lo[i] = std::min(lo[i], hi[i-1] + 1);
+                hi[i] = std::max(hi[i], lo[i-1]);
+            }
+        }
+    }
+}
 
 DTWAligner::DTWAligner(
-    const std::vector<NoteEvent>& ref,
-    const std::vector<NoteEvent>& perf,
+    const NoteSequence& ref,
+    const NoteSequence& perf,
     double ref_bpm,          // 直接传入参考曲目的BPM
-    bool use_interval_matching
+    bool use_interval_matching,
+    DTWConstraint constraint,
+    int band_radius,
+    double max_slope
 ) : ref_notes(ref),
     perf_notes(perf),
     bpm(ref_bpm),             // 初始化BPM
     use_interval(use_interval_matching),
-    ref_mean(0.0)
+    ref_mean(0.0),
+    constraint(constraint),
+    band_radius(band_radius),
+    max_slope(max_slope)
 {
     seconds_per_beat = 60.0 / bpm; 
 
     double total_duration = 0.0;
-    for (const auto& note : ref_notes) {
-        total_duration += note.note_value * seconds_per_beat;
+    for (double value : ref_notes.duration) {
+        total_duration += value * seconds_per_beat;
     }
 
     if (!ref_notes.empty()) {
@@ -32,69 +120,319 @@ DTWAligner::DTWAligner(
               << ", Ref Mean Duration: " << ref_mean << "s\n";
 }
 
-std::pair<std::vector<std::vector<double>>, 
-          std::vector<std::vector<std::pair<int, int>>>> 
+std::pair<int, int> DTWMatrix::previous(int i, int j) const {
+    switch (steps[static_cast<size_t>(i) * cols + j]) {
+        case Up: return {i - 1, j};
+        case Left: return {i, j - 1};
+        case Diagonal: return {i - 1, j - 1};
+        default: return {0, 0};
+    }
+}
 
-DTWAligner::compute_dtw(
+std::vector<std::pair<int, int>> DTWMatrix::warping_path() const {
+    std::vector<std::pair<int, int>> path;
+    int i = rows - 1;
+    int j = cols - 1;
+    while ((i > 0 || j > 0) && steps[static_cast<size_t>(i) * cols + j] != Start) {
+        path.push_back({i, j});
+        std::tie(i, j) = previous(i, j);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+DTWMatrix DTWAligner::compute_dtw(
     const std::vector<std::vector<double>>& seq1, 
     const std::vector<std::vector<double>>& seq2) 
 {
     const int n = seq1.size();
     const int m = seq2.size();
-    std::vector<std::vector<double>> cost(n + 1, std::vector<double>(m + 1, std::numeric_limits<double>::infinity()));
-    cost[0][0] = 0.0;
-
-    std::vector<std::vector<std::pair<int, int>>> path(n + 1, std::vector<std::pair<int, int>>(m + 1));
+    DTWMatrix dtw;
+    dtw.rows = n + 1;
+    dtw.cols = m + 1;
+    dtw.cost.assign(static_cast<size_t>(dtw.rows) * dtw.cols, std::numeric_limits<double>::infinity());
+    dtw.steps.assign(dtw.cost.size(), DTWMatrix::Start);
+    dtw.cost[0] = 0.0;
 
     for (int i = 1; i <= n; ++i) {
+        const std::vector<double>& a = seq1[i-1];
+        double* row = dtw.cost.data() + static_cast<size_t>(i) * dtw.cols;
+        const double* above = row - dtw.cols;
+        uint8_t* step_row = dtw.steps.data() + static_cast<size_t>(i) * dtw.cols;
+
         for (int j = 1; j <= m; ++j) {
-            double diff = 0.0;
-            for (size_t k = 0; k < seq1[i-1].size(); ++k) {
-                diff += std::pow(seq1[i-1][k] - seq2[j-1][k], 2);
+            double diff = feature_distance(a, seq2[j-1]);
+
+            // Up, left, diagonal; the first minimum wins ties.
+            double best = above[j];
+            uint8_t step = DTWMatrix::Up;
+            if (row[j-1] < best) {
+                best = row[j-1];
+                step = DTWMatrix::Left;
+            }
+            if (above[j-1] < best) {
+                best = above[j-1];
+                step = DTWMatrix::Diagonal;
+            }
+            row[j] = diff + best;
+            step_row[j] = step;
+        }
+    }
+    return dtw;
+}
+
+double BandedDTWMatrix::at(int i, int j) const {
+    if (j < lo[i] || j > hi[i]) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return cost[offset[i] + (j - lo[i])];
+}
+
+std::vector<std::pair<int, int>> BandedDTWMatrix::warping_path() const {
+    std::vector<std::pair<int, int>> path;
+    int i = rows - 1;
+    int j = cols - 1;
+    while (i > 0 && j >= lo[i] && j <= hi[i]) {
+        uint8_t step = steps[offset[i] + (j - lo[i])];
+        if (step == DTWMatrix::Start) break;
+        path.push_back({i, j});
+        if (step != DTWMatrix::Left) --i;
+        if (step != DTWMatrix::Up) --j;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+BandedDTWMatrix DTWAligner::compute_banded_dtw(
+    const std::vector<std::vector<double>>& seq1,
+    const std::vector<std::vector<double>>& seq2,
+    std::vector<int> lo,
+    std::vector<int> hi)
+{
+    const int n = seq1.size();
+    const int m = seq2.size();
+    const double inf = std::numeric_limits<double>::infinity();
+    connect_band(m, lo, hi);
+
+    // Row 0 holds only the origin (0, 0).
+    BandedDTWMatrix dtw;
+    dtw.rows = n + 1;
+    dtw.cols = m + 1;
+    dtw.lo = std::move(lo);
+    dtw.hi = std::move(hi);
+    dtw.lo[0] = dtw.hi[0] = 0;
+    dtw.offset.assign(n + 2, 0);
+    for (int i = 0; i <= n; ++i) {
+        dtw.offset[i + 1] = dtw.offset[i] + (dtw.hi[i] - dtw.lo[i] + 1);
+    }
+    dtw.cost.assign(dtw.offset[n + 1], inf);
+    dtw.steps.assign(dtw.offset[n + 1], DTWMatrix::Start);
+    dtw.cost[0] = 0.0;
+
+    for (int i = 1; i <= n; ++i) {
+        const int row_lo = dtw.lo[i];
+        double* row = dtw.cost.data() + dtw.offset[i];
+        uint8_t* step_row = dtw.steps.data() + dtw.offset[i];
+
+        for (int j = row_lo; j <= dtw.hi[i]; ++j) {
+            double diff = feature_distance(seq1[i-1], seq2[j-1]);
+
+            // Same order and tie-break as the full kernel.
+            double best = dtw.at(i - 1, j);
+            uint8_t step = DTWMatrix::Up;
+            double left = (j > row_lo) ? row[j - 1 - row_lo] : inf;
+            if (left < best) {
+                best = left;
+                step = DTWMatrix::Left;
             }
-            diff = std::sqrt(diff);
-
-            std::vector<double> candidates {
-                cost[i-1][j], 
-                cost[i][j-1], 
-                cost[i-1][j-1]
-            };
-            auto min_it = std::min_element(candidates.begin(), candidates.end());
-            cost[i][j] = diff + *min_it;
-
-            int dir = std::distance(candidates.begin(), min_it);
-            switch (dir) {
-                case 0: path[i][j] = {i-1, j}; break;
-                case 1: path[i][j] = {i, j-1}; break;
-                case 2: path[i][j] = {i-1, j-1}; break;
+            double diagonal = dtw.at(i - 1, j - 1);
+            if (diagonal < best) {
+                best = diagonal;
+                step = DTWMatrix::Diagonal;
             }
+            row[j - row_lo] = diff + best;
+            step_row[j - row_lo] = step;
+        }
+    }
+    return dtw;
+}
+
+WarpingPath DTWAligner::align_piece() {
+    auto ref_rel = calculate_relative_metrics(ref_notes);
+    auto perf_rel = calculate_relative_metrics(perf_notes);
+    WarpingPath result;
+    if (ref_rel.empty() || perf_rel.empty()) return result;
+
+    const int n = ref_rel.size();
+    const int m = perf_rel.size();
+    std::vector<std::pair<int, int>> cells;
+    if (constraint == DTWConstraint::None) {
+        DTWMatrix dtw = compute_dtw(ref_rel, perf_rel);
+        result.cost = dtw.total();
+        cells = dtw.warping_path();
+    } else {
+        std::vector<int> lo, hi;
+        if (constraint == DTWConstraint::SakoeChiba) {
+            sakoe_chiba_band(n, m, band_radius, lo, hi);
+        } else {
+            itakura_band(n, m, max_slope, lo, hi);
         }
+        BandedDTWMatrix dtw = compute_banded_dtw(ref_rel, perf_rel, std::move(lo), std::move(hi));
+        result.cost = dtw.total();
+        cells = dtw.warping_path();
+    }
+
+    result.pairs.reserve(cells.size());
+    for (const auto& [i, j] : cells) {
+        result.pairs.push_back({i - 1, j - 1});
     }
-    return {cost, path};
+    return result;
+}
+
+WarpingPath DTWAligner::fast_dtw(
+    const std::vector<std::vector<double>>& seq1,
+    const std::vector<std::vector<double>>& seq2,
+    int radius)
+{
+    const int n = seq1.size();
+    const int m = seq2.size();
+    const int min_size = radius + 2;
+    WarpingPath result;
+
+    if (n <= min_size || m <= min_size) {
+        DTWMatrix dtw = compute_dtw(seq1, seq2);
+        result.cost = dtw.total();
+        for (const auto& [i, j] : dtw.warping_path()) {
+            result.pairs.push_back({i - 1, j - 1});
+        }
+        return result;
+    }
+
+    WarpingPath coarse = fast_dtw(coarsen(seq1), coarsen(seq2), radius);
+
+    // Every coarse cell covers a 2 x 2 block here; widen it by `radius`
+    // coarse cells and keep each row's column hull as the band.
+    std::vector<int> lo(n + 1, INT_MAX);
+    std::vector<int> hi(n + 1, -1);
+    for (const auto& [ci, cj] : coarse.pairs) {
+        const int col_lo = std::max(0, 2 * (cj - radius));
+        const int col_hi = std::min(m - 1, 2 * (cj + radius) + 1);
+        const int row_end = std::min(n - 1, 2 * (ci + radius) + 1);
+        for (int row = std::max(0, 2 * (ci - radius)); row <= row_end; ++row) {
+            lo[row + 1] = std::min(lo[row + 1], col_lo + 1);
+            hi[row + 1] = std::max(hi[row + 1], col_hi + 1);
+        }
+    }
+
+    BandedDTWMatrix dtw = compute_banded_dtw(seq1, seq2, std::move(lo), std::move(hi));
+    result.cost = dtw.total();
+    for (const auto& [i, j] : dtw.warping_path()) {
+        result.pairs.push_back({i - 1, j - 1});
+    }
+    return result;
+}
+
+WarpingPath DTWAligner::align_piece_fast(int radius) {
+    auto ref_rel = calculate_relative_metrics(ref_notes);
+    auto perf_rel = calculate_relative_metrics(perf_notes);
+    if (ref_rel.empty() || perf_rel.empty()) return {};
+    return fast_dtw(ref_rel, perf_rel, std::max(0, radius));
+}
+
+OnlineDTWFollower::OnlineDTWFollower(const NoteSequence& ref, int window)
+    : ref_features(DTWAligner::calculate_relative_metrics(ref)),
+      window(std::max(1, window))
+{
+    if (ref_features.empty()) {
+        throw std::runtime_error("Cannot follow an empty reference");
+    }
+    column.reserve(this->window);
+    next_column.reserve(this->window);
+    perf_features.reserve(3);
+}
+
+FollowPosition OnlineDTWFollower::push(const NoteEvent& note) {
+    const auto started = std::chrono::steady_clock::now();
+    const double inf = std::numeric_limits<double>::infinity();
+    const int n = ref_features.size();
+    const int j = seen;
+
+    if (seen == 0) {
+        first_start = note.start;
+        prev_pitch = note.pitch;
+    }
+    perf_features = {
+        static_cast<double>(note.pitch - prev_pitch),
+        note.note_value,
+        note.start - first_start
+    };
+    prev_pitch = note.pitch;
+
+    auto previous = [&](int i) {
+        int k = i - column_lo;
+        return (k >= 0 && k < static_cast<int>(column.size())) ? column[k] : inf;
+    };
+
+    // The first column starts at reference note 0; later ones extend the
+    // last column (left, diagonal) and themselves (up).
+    const int lo = window_lo;
+    const int hi = std::min(n, lo + window);
+    next_column.assign(hi - lo, inf);
+    FollowPosition result{j, current, inf, {}};
+    double best_normalized = inf;
+    for (int i = lo; i < hi; ++i) {
+        double best = (j == 0) ? (i == 0 ? 0.0 : inf)
+                               : std::min(previous(i), previous(i - 1));
+        if (i > lo) best = std::min(best, next_column[i - lo - 1]);
+        if (best == inf) continue;
+
+        double cost = best + feature_distance(ref_features[i], perf_features);
+        next_column[i - lo] = cost;
+        // Normalise by path length so longer paths are not penalised.
+        double normalized = cost / (i + j + 2);
+        if (normalized < best_normalized) {
+            best_normalized = normalized;
+            result.ref_index = i;
+            result.cost = cost;
+        }
+    }
+
+    std::swap(column, next_column);
+    column_lo = lo;
+    current = result.ref_index;
+    // Centre the next window on the match without moving it backwards or
+    // past the end; it never passes `current`, so the path stays connected.
+    window_lo = std::max(lo, std::min(current - window / 2, n - window));
+
+    ++seen;
+    last = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - started);
+    worst = std::max(worst, last);
+    result.latency = last;
+    return result;
 }
 
 std::vector<std::vector<double>> DTWAligner::calculate_relative_metrics(
-    const std::vector<NoteEvent>& notes) 
+    const NoteSequence& notes) 
 {
     std::vector<std::vector<double>> rel_notes;
     if (notes.empty()) return rel_notes;
 
-    double first_start = notes[0].start;
-    int prev_pitch = notes[0].pitch;
+    double first_start = notes.onset[0];
+    int prev_pitch = notes.pitch[0];
 
 
     rel_notes.push_back({
         0.0,
-        notes[0].note_value,
+        notes.duration[0],
         0.0
     });
 
     for (size_t i = 1; i < notes.size(); ++i) {
-        const auto& n = notes[i];
-        int interval = n.pitch - prev_pitch;
-        prev_pitch = n.pitch;
-        double rel_duration = n.note_value;  
-        double rel_start = n.start - first_start;
+        int interval = notes.pitch[i] - prev_pitch;
+        prev_pitch = notes.pitch[i];
+        double rel_duration = notes.duration[i];  
+        double rel_start = notes.onset[i] - first_start;
 
         rel_notes.push_back({
             static_cast<double>(interval),
@@ -120,8 +458,7 @@ double DTWAligner::context_distance(
     const std::vector<std::vector<double>>& ctx1,
     const std::vector<std::vector<double>>& ctx2) 
 {
-    auto [cost_matrix, _] = compute_dtw(ctx1, ctx2);
-    return cost_matrix.back().back();
+    return compute_dtw(ctx1, ctx2).total();
 }
 
 
@@ -132,12 +469,12 @@ void DTWAligner::add_match(
     double score, 
     int round) 
 {
-    double time_correction = ref_notes[r_idx].note_value / perf_notes[p_idx].note_value;
+    double time_correction = ref_notes.duration[r_idx] / perf_notes.duration[p_idx];
     
     matches.push_back({
         p_idx,
-        perf_notes[p_idx],
-        ref_notes[r_idx],
+        perf_notes.at(p_idx),
+        ref_notes.at(r_idx),
         time_correction,
         score,
         (round == 1) ? "Round1" : "Round2"
@@ -151,7 +488,7 @@ void DTWAligner::add_unmatched(
 {
     matches.push_back({
         p_idx,
-        perf_notes[p_idx],
+        perf_notes.at(p_idx),
         NoteEvent{0, 0, 0},
         1.0,
         std::numeric_limits<double>::quiet_NaN(),
@@ -163,6 +500,29 @@ std::vector<MatchResult> DTWAligner::align_notes() {
     auto ref_rel = calculate_relative_metrics(ref_notes);
     auto perf_rel = calculate_relative_metrics(perf_notes);
 
+    // Reference notes bucketed by interval and sorted by relative start, so
+    // each performance note only visits notes that can pass the filters.
+    std::unordered_map<int, std::vector<std::pair<double, int>>> by_interval;
+    for (size_t r_idx = 0; r_idx < ref_rel.size(); ++r_idx) {
+        by_interval[static_cast<int>(ref_rel[r_idx][0])].emplace_back(ref_rel[r_idx][2], r_idx);
+    }
+    for (auto& bucket : by_interval) {
+        std::sort(bucket.second.begin(), bucket.second.end());
+    }
+    std::vector<std::vector<std::vector<double>>> ref_ctx(ref_rel.size());
+    for (size_t r_idx = 0; r_idx < ref_rel.size(); ++r_idx) {
+        ref_ctx[r_idx] = get_context_features(ref_rel, r_idx);
+    }
+
+    // Candidates are visited out of reference order, so equal scores go to
+    // the lowest index, as a left-to-right scan would pick.
+    auto consider = [](double score, int r_idx, double& min_score, int& best_ref_idx) {
+        if (score < min_score || (score == min_score && r_idx < best_ref_idx)) {
+            min_score = score;
+            best_ref_idx = r_idx;
+        }
+    };
+
     std::vector<MatchResult> matches;
     std::unordered_map<int, bool> matched_ref, matched_perf;
     for (size_t p_idx = 0; p_idx < perf_rel.size(); ++p_idx) {
@@ -171,20 +531,25 @@ std::vector<MatchResult> DTWAligner::align_notes() {
         double min_score = std::numeric_limits<double>::max();
         int best_ref_idx = -1;
 
-        for (size_t r_idx = 0; r_idx < ref_rel.size(); ++r_idx) {
-            if (matched_ref[r_idx]) continue;
-
-            if (std::abs(ref_rel[r_idx][0] - perf_rel[p_idx][0]) > 0.0) continue;
-            if (std::abs(ref_rel[r_idx][1] - perf_rel[p_idx][1]) > duration_tolerance_ratio * ref_mean) continue;
-            if (std::abs(ref_rel[r_idx][2] - perf_rel[p_idx][2]) > position_tolerance) continue;
-
-            auto ctx_ref = get_context_features(ref_rel, r_idx);
+        auto bucket = by_interval.find(static_cast<int>(perf_rel[p_idx][0]));
+        if (bucket != by_interval.end()) {
+            const auto& candidates = bucket->second;
+            const double p_start = perf_rel[p_idx][2];
+            // Widened slightly so rounding cannot drop a note the exact
+            // check below accepts.
+            const double slack = position_tolerance * (1.0 + 1e-9) + 1e-9;
+            auto it = std::lower_bound(candidates.begin(), candidates.end(),
+                                       std::make_pair(p_start - slack, INT_MIN));
             auto ctx_perf = get_context_features(perf_rel, p_idx);
-            double score = context_distance(ctx_ref, ctx_perf);
+            for (; it != candidates.end() && it->first <= p_start + slack; ++it) {
+                const int r_idx = it->second;
+                if (matched_ref[r_idx]) continue;
+
+                if (std::abs(ref_rel[r_idx][0] - perf_rel[p_idx][0]) > 0.0) continue;
+                if (std::abs(ref_rel[r_idx][1] - perf_rel[p_idx][1]) > duration_tolerance_ratio * ref_mean) continue;
+                if (std::abs(ref_rel[r_idx][2] - perf_rel[p_idx][2]) > position_tolerance) continue;
 
-            if (score < min_score) {
-                min_score = score;
-                best_ref_idx = r_idx;
+                consider(context_distance(ref_ctx[r_idx], ctx_perf), r_idx, min_score, best_ref_idx);
             }
         }
 
@@ -195,24 +560,25 @@ std::vector<MatchResult> DTWAligner::align_notes() {
         }
     }
 
+    // Round 2 drops the duration and position filters and lets the interval
+    // differ by one semitone, so it visits the three neighbouring buckets.
     for (size_t p_idx = 0; p_idx < perf_rel.size(); ++p_idx) {
         if (matched_perf[p_idx]) continue;
 
         double min_score = std::numeric_limits<double>::max();
         int best_ref_idx = -1;
 
-        for (size_t r_idx = 0; r_idx < ref_rel.size(); ++r_idx) {
-            if (matched_ref[r_idx]) continue;
+        const int interval = static_cast<int>(perf_rel[p_idx][0]);
+        auto ctx_perf = get_context_features(perf_rel, p_idx);
+        for (int key = interval - 1; key <= interval + 1; ++key) {
+            auto bucket = by_interval.find(key);
+            if (bucket == by_interval.end()) continue;
 
-            if (std::abs(ref_rel[r_idx][0] - perf_rel[p_idx][0]) > 1.0) continue;
-
-            auto ctx_ref = get_context_features(ref_rel, r_idx);
-            auto ctx_perf = get_context_features(perf_rel, p_idx);
-            double score = context_distance(ctx_ref, ctx_perf);
+            for (const auto& candidate : bucket->second) {
+                const int r_idx = candidate.second;
+                if (matched_ref[r_idx]) continue;
 
-            if (score < min_score) {
-                min_score = score;
-                best_ref_idx = r_idx;
+                consider(context_distance(ref_ctx[r_idx], ctx_perf), r_idx, min_score, best_ref_idx);
             }
         }
 
@@ -1,8 +1,12 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <utility>
 #include <vector>
 #include <string>
 #include <functional>
 #include "common_defs.h" 
+#include "note_sequence.h"
 
 struct MatchResult {
     int order;
@@ -18,34 +22,153 @@ struct MatchResult {
           time_correction(tc), dtw_score(score), match_round(round) {}
 };
 
+// Accumulated-cost matrix of one DTW run, (n + 1) x (m + 1) and row-major in
+// a single buffer, with one byte per cell for the step that reached it.
+struct DTWMatrix {
+    enum Step : uint8_t { Start = 0, Up = 1, Left = 2, Diagonal = 3 };
+
+    int rows = 0;
+    int cols = 0;
+    std::vector<double> cost;
+    std::vector<uint8_t> steps;
+
+    double at(int i, int j) const { return cost[static_cast<size_t>(i) * cols + j]; }
+    double total() const { return cost.back(); }
+    // Cell the step into (i, j) came from; (0, 0) for cells never reached.
+    std::pair<int, int> previous(int i, int j) const;
+    // Cells from the first aligned pair to (n, m), following the steps back.
+    std::vector<std::pair<int, int>> warping_path() const;
+};
+
+// DTW restricted to a contiguous column range [lo[i], hi[i]] in each row i
+// (1-based), so storage and work are proportional to the band area.
+struct BandedDTWMatrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<int> lo;
+    std::vector<int> hi;
+    std::vector<size_t> offset;
+    std::vector<double> cost;
+    std::vector<uint8_t> steps;
+
+    // Infinity outside the band.
+    double at(int i, int j) const;
+    double total() const { return at(rows - 1, cols - 1); }
+    std::vector<std::pair<int, int>> warping_path() const;
+};
+
+// Global constraint for whole-piece alignment. SakoeChiba keeps cells within
+// band_radius columns of the diagonal from (1, 1) to (n, m); Itakura keeps
+// the parallelogram whose local slope stays within [1 / max_slope, max_slope].
+enum class DTWConstraint {
+    None,
+    SakoeChiba,
+    Itakura
+};
+
+// A whole-piece alignment: (reference index, performance index) pairs in
+// order, and the accumulated feature distance along them.
+struct WarpingPath {
+    double cost = 0.0;
+    std::vector<std::pair<int, int>> pairs;
+};
+
 class DTWAligner {
 public:
-    DTWAligner(const std::vector<NoteEvent>& ref,
-               const std::vector<NoteEvent>& perf,
+    DTWAligner(const NoteSequence& ref,
+               const NoteSequence& perf,
                double ref_bpm,
-               bool use_interval_matching = false);
+               bool use_interval_matching = false,
+               DTWConstraint constraint = DTWConstraint::None,
+               int band_radius = 32,
+               double max_slope = 2.0);
 
     std::vector<MatchResult> align_notes();
+    // DTW over the relative-metric features of the whole piece, limited to
+    // the constructor's band: O(n * band) time and memory when constrained.
+    WarpingPath align_piece();
+    // FastDTW: aligns half-resolution features recursively, then refines each
+    // level only inside the projected path widened by `radius` coarse cells.
+    // Approximates unconstrained align_piece() in O(n * radius).
+    WarpingPath align_piece_fast(int radius = 1);
+
+    // Per-note features {interval to previous note, note value, onset
+    // relative to the first note}; the first note's interval is 0.
+    static std::vector<std::vector<double>> calculate_relative_metrics(const NoteSequence& notes);
 
 private:
-    std::vector<NoteEvent> ref_notes;
-    std::vector<NoteEvent> perf_notes;
+    NoteSequence ref_notes;
+    NoteSequence perf_notes;
     double bpm;
     double seconds_per_beat;
     bool use_interval;
     double ref_mean;
+    DTWConstraint constraint;
+    int band_radius;
+    double max_slope;
 
     const double duration_tolerance_ratio = 0.3;
     const double position_tolerance = 0.5;
 
-    std::pair<std::vector<std::vector<double>>, 
-              std::vector<std::vector<std::pair<int, int>>>> 
-    compute_dtw(const std::vector<std::vector<double>>& seq1, 
-               const std::vector<std::vector<double>>& seq2);
+    DTWMatrix compute_dtw(const std::vector<std::vector<double>>& seq1,
+                          const std::vector<std::vector<double>>& seq2);
+    BandedDTWMatrix compute_banded_dtw(const std::vector<std::vector<double>>& seq1,
+                                       const std::vector<std::vector<double>>& seq2,
+                                       std::vector<int> lo,
+                                       std::vector<int> hi);
+    WarpingPath fast_dtw(const std::vector<std::vector<double>>& seq1,
+                         const std::vector<std::vector<double>>& seq2,
+                         int radius);
 
-    std::vector<std::vector<double>> calculate_relative_metrics(const std::vector<NoteEvent>& notes);
     std::vector<std::vector<double>> get_context_features(const std::vector<std::vector<double>>& notes, int index);
     double context_distance(const std::vector<std::vector<double>>& ctx1, const std::vector<std::vector<double>>& ctx2);
     void add_match(std::vector<MatchResult>& matches, int p_idx, int r_idx, double score, int round);
     void add_unmatched(std::vector<MatchResult>& matches, int p_idx);
-};
\ No newline at end of file
+};
+
+// Where the follower places the performance after one more note.
+struct FollowPosition {
+    int perf_index;
+    int ref_index;
+    // Accumulated cost of the best path ending at (ref_index, perf_index).
+    double cost;
+    std::chrono::nanoseconds latency;
+};
+
+// Online time warping for score following, after Dixon's OLTW. The
+// reference goes through the same relative-metric features as DTWAligner;
+// performance notes arrive one at a time and each extends a single DTW
+// column limited to `window` reference notes. The window only moves forward,
+// staying centred on the best match, so a note costs O(window) time and the
+// follower holds two columns instead of the full matrix.
+class OnlineDTWFollower {
+public:
+    explicit OnlineDTWFollower(const NoteSequence& ref, int window = 64);
+
+    // Notes must arrive in onset order.
+    FollowPosition push(const NoteEvent& note);
+
+    int position() const { return current; }
+    size_t notes_seen() const { return seen; }
+    std::chrono::nanoseconds last_latency() const { return last; }
+    std::chrono::nanoseconds max_latency() const { return worst; }
+
+private:
+    std::vector<std::vector<double>> ref_features;
+    int window;
+
+    // Costs of the last column for reference rows [column_lo, column_lo + size).
+    int column_lo = 0;
+    std::vector<double> column;
+    std::vector<double> next_column;
+    // First reference row of the next column.
+    int window_lo = 0;
+    std::vector<double> perf_features;
+
+    double first_start = 0.0;
+    int prev_pitch = 0;
+    int current = 0;
+    size_t seen = 0;
+    std::chrono::nanoseconds last{0};
+    std::chrono::nanoseconds worst{0};
+};
@@ -164,7 +164,7 @@ void run_alignment_process() {
 
 #if USE_DTW_ALIGNER
         if (ref_notes.size() > 1) {
-            DTWAligner aligner(ref_notes, perf_notes, ref_bpm);
+            DTWAligner aligner(NoteSequence(ref_notes), NoteSequence(perf_notes), ref_bpm);
             auto matches = aligner.align_notes();
             generate_alignment_report(matches);
         } else {
@@ -0,0 +1,38 @@
+#include "note_sequence.h"
+#include <stdexcept>
+#include <string>
+
+NoteSequence::NoteSequence(const std::vector<NoteEvent>& events) {
+    reserve(events.size());
+    for (const auto& note : events) {
+        push_back(note);
+    }
+}
+
+void NoteSequence::reserve(size_t count) {
+    pitch.reserve(count);
+    onset.reserve(count);
+    duration.reserve(count);
+}
+
+void NoteSequence::push_back(const NoteEvent& note) {
+    if (note.pitch < 0 || note.pitch > 127) {
+        throw std::runtime_error("Pitch is not a MIDI key number: " + std::to_string(note.pitch));
+    }
+    pitch.push_back(static_cast<int8_t>(note.pitch));
+    onset.push_back(note.start);
+    duration.push_back(note.note_value);
+}
+
+NoteEvent NoteSequence::at(size_t i) const {
+    return {onset[i], pitch[i], duration[i]};
+}
+
+std::vector<NoteEvent> NoteSequence::to_events() const {
+    std::vector<NoteEvent> events;
+    events.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        events.push_back(at(i));
+    }
+    return events;
+}
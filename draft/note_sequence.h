@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "common_defs.h"
+
+// Column-wise (structure-of-arrays) storage for a note list, as in src/.
+// The DTW feature pass reads pitch, onset and duration as separate streams;
+// MIDI key numbers fit in a byte.
+struct NoteSequence {
+    std::vector<int8_t> pitch;
+    std::vector<double> onset;
+    std::vector<double> duration;   // NoteEvent::note_value, in quarter notes
+
+    NoteSequence() = default;
+    // Copies every note; explicit so the O(n) conversion shows at call sites.
+    explicit NoteSequence(const std::vector<NoteEvent>& events);
+
+    size_t size() const { return pitch.size(); }
+    bool empty() const { return pitch.empty(); }
+
+    void reserve(size_t count);
+    // Throws if the pitch is not a MIDI key number (0-127).
+    void push_back(const NoteEvent& note);
+    NoteEvent at(size_t i) const;
+    std::vector<NoteEvent> to_events() const;
+};
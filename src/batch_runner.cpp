@@ -0,0 +1,173 @@
+#include "batch_runner.h"
+#include "metrics.h"
+#include "midi_io.h"
+#include "reference_index.h"
+#include "similarity_calculator.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+    bool is_midi_file(const fs::path& path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return ext == ".mid" || ext == ".midi";
+    }
+
+    std::string format_result(size_t index,
+                              const std::string& path,
+                              size_t note_count,
+                              bool fallback_triggered,
+                              const std::vector<MatchSegment>& segments) {
+        std::ostringstream line;
+        double best = segments.empty() ? 0.0 : segments.front().similarity;
+        line << index << "\t" << path << "\t" << note_count << "\t"
+             << (fallback_triggered ? "yes" : "no") << "\t"
+             << segments.size() << "\t"
+             << std::fixed << std::setprecision(1) << best << "\t";
+        for (size_t k = 0; k < segments.size(); ++k) {
+            const auto& seg = segments[k];
+            if (k > 0) line << ";";
+            line << seg.ref_start << ":" << seg.perf_start << ":" << seg.length << ":" << seg.similarity;
+        }
+        return line.str();
+    }
+
+    template <typename Scoring>
+    std::string grade_performance(size_t index,
+                                  const std::string& path,
+                                  const ReferenceIndex* ref_index,
+                                  const NoteSequence& ref_notes,
+                                  double similarity_threshold) {
+        auto perf_notes = MIDIIO::parse_midi_sequence(path);
+        // An index carries the reference's suffix array, so only the
+        // performance is scanned per job.
+        BasicSimilarityCalculator<Scoring> calculator = ref_index
+            ? BasicSimilarityCalculator<Scoring>(*ref_index, perf_notes,
+                                                 CandidateMode::AllPrefixes, MatchEngine::SuffixArray)
+            : BasicSimilarityCalculator<Scoring>(ref_notes, perf_notes);
+        auto segments = calculator.find_similar_segments(similarity_threshold);
+        return format_result(index, path, perf_notes.size(),
+                             calculator.was_fallback_used(), segments);
+    }
+}
+
+namespace BatchRunner {
+    std::vector<std::string> collect_midi_paths(const std::string& directory_or_manifest) {
+        std::vector<std::string> paths;
+        fs::path source(directory_or_manifest);
+
+        if (fs::is_directory(source)) {
+            for (const auto& entry : fs::directory_iterator(source)) {
+                if (entry.is_regular_file() && is_midi_file(entry.path())) {
+                    paths.push_back(entry.path().string());
+                }
+            }
+            std::sort(paths.begin(), paths.end());
+            return paths;
+        }
+
+        std::ifstream manifest(directory_or_manifest);
+        if (!manifest) {
+            throw std::runtime_error("Failed to open performance list: " + directory_or_manifest);
+        }
+        std::string line;
+        while (std::getline(manifest, line)) {
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line[0] == '#') continue;
+            paths.push_back(line);
+        }
+        return paths;
+    }
+
+    int run_batch_process(const BatchOptions& options) {
+        // A prebuilt .nnidx reference is mapped instead of parsed.
+        const bool use_index = ReferenceIndex::is_index_path(options.reference_path);
+        ReferenceIndex ref_index;
+        NoteSequence ref_notes;
+        if (use_index) {
+            ref_index = ReferenceIndex::open(options.reference_path);
+        } else {
+            ref_notes = MIDIIO::parse_midi_sequence(options.reference_path);
+        }
+        const size_t ref_count = use_index ? ref_index.note_count() : ref_notes.size();
+        const std::vector<std::string> perf_paths = collect_midi_paths(options.performances);
+
+        std::ofstream report_file;
+        if (!options.report_path.empty()) {
+            report_file.open(options.report_path);
+            if (!report_file) {
+                throw std::runtime_error("Failed to open report: " + options.report_path);
+            }
+        }
+        std::ostream& report = options.report_path.empty() ? std::cout : report_file;
+
+        report << "# reference\t" << options.reference_path << "\t" << ref_count << " notes\n"
+               << "index\tperformance\tnotes\tfallback\tsegments\tbest_similarity\tmatches"
+               << " (ref_start:perf_start:length:similarity)\n";
+
+        std::mutex report_mutex;
+        std::atomic<int> failures{0};
+        {
+            ThreadPool pool(options.threads);
+            for (size_t index = 0; index < perf_paths.size(); ++index) {
+                pool.submit([&, index] {
+                    const std::string& path = perf_paths[index];
+                    std::string line;
+                    const ReferenceIndex* index_ptr = use_index ? &ref_index : nullptr;
+                    const double threshold = options.similarity_threshold;
+                    try {
+                        switch (options.profile) {
+                        case SegmentScoring::Profile::StrictRhythm:
+                            line = grade_performance<SegmentScoring::StrictRhythm>(
+                                index, path, index_ptr, ref_notes, threshold);
+                            break;
+                        case SegmentScoring::Profile::Lenient:
+                            line = grade_performance<SegmentScoring::Lenient>(
+                                index, path, index_ptr, ref_notes, threshold);
+                            break;
+                        default:
+                            line = grade_performance<SegmentScoring::Standard>(
+                                index, path, index_ptr, ref_notes, threshold);
+                            break;
+                        }
+                    } catch (const std::exception& e) {
+                        ++failures;
+                        line = std::to_string(index) + "\t" + path + "\terror\t" + e.what();
+                    }
+
+                    std::lock_guard<std::mutex> lock(report_mutex);
+                    report << line << "\n";
+                    report.flush();
+                });
+            }
+            pool.wait();
+        }
+
+        std::cerr << "[Batch] " << perf_paths.size() << " performances, "
+                  << failures.load() << " failed\n";
+
+#ifdef NNOTE_ENABLE_METRICS
+        // One snapshot for the whole batch, in both formats, next to the
+        // report (or batch_metrics.* in the working directory for stdout).
+        const std::string metrics_base = options.report_path.empty()
+            ? std::string("batch")
+            : fs::path(options.report_path).replace_extension().string();
+        Metrics::write_report(metrics_base + "_metrics.json");
+        Metrics::write_report(metrics_base + "_metrics.prom");
+        std::cerr << "[Metrics] Saved: " << metrics_base << "_metrics.json / .prom\n";
+#endif
+        return failures.load();
+    }
+}
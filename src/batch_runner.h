@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "segment_scoring.h"
+
+struct BatchOptions {
+    // A reference .mid file, or a .nnidx reference index.
+    std::string reference_path;
+    // A directory of .mid files or a manifest listing one path per line.
+    std::string performances;
+    // Report destination; empty writes the report to stdout.
+    std::string report_path;
+    size_t threads = 0;
+    double similarity_threshold = 70.0;
+    // Grading profile; each one runs its own compiled calculator.
+    SegmentScoring::Profile profile = SegmentScoring::Profile::Standard;
+};
+
+namespace BatchRunner {
+    // The .mid/.midi files in a directory (sorted), or the paths listed in a
+    // manifest file, one per line.
+    std::vector<std::string> collect_midi_paths(const std::string& directory_or_manifest);
+
+    // Parses the reference once, matches every performance against it on a
+    // thread pool and streams one report line per performance as it
+    // finishes. Returns the number of performances that failed.
+    int run_batch_process(const BatchOptions& options);
+}
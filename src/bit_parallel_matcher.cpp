@@ -0,0 +1,79 @@
+#include "bit_parallel_matcher.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+    // One column of Myers' recurrence. `anchored` makes the first pattern row
+    // grow with the text (a fixed start); otherwise a match may start anywhere.
+    inline int advance(uint64_t eq, uint64_t& pv, uint64_t& mv, uint64_t mask,
+                       uint64_t high_bit, bool anchored, int score) {
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & high_bit) {
+            ++score;
+        } else if (mh & high_bit) {
+            --score;
+        }
+        ph = (ph << 1) | (anchored ? 1 : 0);
+        mh <<= 1;
+        pv = (mh | ~(xv | ph)) & mask;
+        mv = (ph & xv) & mask;
+        return score;
+    }
+}
+
+int BitParallelMatcher::symbol(int interval) {
+    // Slot 0 never has a pattern bit set, so out-of-range values never match.
+    if (interval < -127 || interval > 127) return 0;
+    return interval + 128;
+}
+
+BitParallelMatcher::BitParallelMatcher(const int* pattern, int length) : length(length) {
+    if (length < 1 || length > max_pattern_length) {
+        throw std::invalid_argument("BitParallelMatcher pattern must hold 1 to 64 intervals");
+    }
+    mask = (length == 64) ? ~uint64_t(0) : ((uint64_t(1) << length) - 1);
+    high_bit = uint64_t(1) << (length - 1);
+    for (int i = 0; i < length; ++i) {
+        int s = symbol(pattern[i]);
+        if (s == 0) continue;
+        peq[s] |= uint64_t(1) << i;
+        peq_reversed[s] |= uint64_t(1) << (length - 1 - i);
+    }
+}
+
+std::vector<int> BitParallelMatcher::search(const int* text, int text_length) const {
+    std::vector<int> distances(std::max(text_length, 0));
+    uint64_t pv = mask;
+    uint64_t mv = 0;
+    int score = length;
+    for (int j = 0; j < text_length; ++j) {
+        score = advance(peq[symbol(text[j])], pv, mv, mask, high_bit, false, score);
+        distances[j] = score;
+    }
+    return distances;
+}
+
+int BitParallelMatcher::best_start(const int* text, int end, int max_edits, int& distance) const {
+    // Run the reversed pattern backwards from `end` with the start pinned, so
+    // after t steps the score is the distance to text[end - t + 1 .. end].
+    uint64_t pv = mask;
+    uint64_t mv = 0;
+    int score = length;
+    int best = end + 1;
+    distance = length;
+    const int span = std::min(end + 1, length + max_edits);
+    for (int t = 1; t <= span; ++t) {
+        score = advance(peq_reversed[symbol(text[end - t + 1])], pv, mv, mask, high_bit, true, score);
+        int start = end - t + 1;
+        bool closer = std::abs(t - length) < std::abs(end - best + 1 - length);
+        if (score < distance || (score == distance && closer)) {
+            distance = score;
+            best = start;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Myers/Hyyro bit-parallel edit distance over the interval alphabet. A
+// pattern of up to 64 intervals occupies one machine word, so every text
+// position costs a handful of word operations regardless of pattern length.
+// Intervals are MIDI pitch differences and always lie in [-127, 127]; any
+// other value is treated as matching nothing.
+class BitParallelMatcher {
+public:
+    static constexpr int max_pattern_length = 64;
+
+    BitParallelMatcher(const int* pattern, int length);
+
+    // distances[j] is the smallest edit distance between the pattern and any
+    // substring of `text` that ends at text[j].
+    std::vector<int> search(const int* text, int text_length) const;
+
+    // Start of the substring ending at text[end] that best matches the
+    // pattern: scans back at most length + max_edits positions and returns
+    // the start with the lowest distance (the one closest to the pattern
+    // length on ties). `distance` receives that distance.
+    int best_start(const int* text, int end, int max_edits, int& distance) const;
+
+private:
+    int length;
+    uint64_t mask;
+    uint64_t high_bit;
+    std::array<uint64_t, 256> peq{};
+    std::array<uint64_t, 256> peq_reversed{};
+
+    static int symbol(int interval);
+};
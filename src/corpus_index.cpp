@@ -0,0 +1,382 @@
+#include "corpus_index.h"
+#include "ngram_seeds.h"
+#include "segment_scoring.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    constexpr char corpus_magic[8] = {'N', 'N', 'C', 'O', 'R', 'P', 'U', 'S'};
+    constexpr uint32_t corpus_version = 1;
+    constexpr uint32_t byte_order_mark = 0x01020304;
+    constexpr uint32_t flag_rhythm_tokens = 1;
+    constexpr int max_gram_length = 64;
+
+    struct CorpusHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t gram_length;
+        uint32_t flags;
+        uint64_t reference_count;
+        uint64_t note_count;
+        uint64_t key_count;
+        uint64_t posting_count;
+        uint64_t references_offset;
+        uint64_t names_offset;
+        uint64_t names_size;
+        uint64_t intervals_offset;
+        uint64_t values_offset;
+        uint64_t keys_offset;
+        uint64_t postings_offset;
+    };
+
+    struct StoredReference {
+        uint64_t name_offset;
+        uint32_t name_length;
+        uint32_t note_count;
+        uint64_t first_note;
+    };
+
+    // key_count + 1 entries; the last one only closes the final postings list.
+    struct StoredKey {
+        uint64_t key;
+        uint64_t first_posting;
+    };
+
+    struct StoredPosting {
+        uint32_t reference;
+        uint32_t offset;
+    };
+
+    static_assert(sizeof(StoredReference) == 24, "StoredReference must have no padding");
+    static_assert(sizeof(StoredKey) == 16, "StoredKey must have no padding");
+    static_assert(sizeof(StoredPosting) == 8, "StoredPosting must have no padding");
+
+    uint64_t align8(uint64_t offset) {
+        return (offset + 7) & ~uint64_t(7);
+    }
+
+    // True when `count` elements of `width` bytes at `offset` lie inside a
+    // file of `size` bytes, starting on an 8-byte boundary, without any sum
+    // or product that could wrap.
+    bool section_fits(uint64_t offset, uint64_t count, uint64_t width, uint64_t size) {
+        return offset % 8 == 0 && offset <= size && count <= (size - offset) / width;
+    }
+
+    // Two buckets per doubling of duration: coarse enough that notes within
+    // the rhythm tolerance usually share a bucket.
+    int rhythm_bucket(double note_value) {
+        if (!(note_value > 0.0)) return 0;
+        int bucket = static_cast<int>(std::lround(std::log2(note_value) * 2.0)) + 32;
+        return std::clamp(bucket, 1, 63);
+    }
+
+    // Key of the n-gram starting at interval `p`. With rhythm tokens the
+    // buckets of the n + 1 notes it spans are mixed in.
+    uint64_t gram_key(const int* intervals, const int* buckets, int n) {
+        uint64_t key = NgramSeeds::RollingHash(n).init(intervals);
+        if (buckets) {
+            uint64_t rhythm = NgramSeeds::RollingHash(n + 1).init(buckets);
+            key ^= rhythm * 0xc2b2ae3d27d4eb4fULL + 0x165667b19e3779f9ULL;
+        }
+        return key;
+    }
+
+    void write_section(std::ofstream& out, uint64_t& written, uint64_t offset,
+                       const void* data, size_t bytes) {
+        static const char zeros[8] = {};
+        out.write(zeros, static_cast<std::streamsize>(offset - written));
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        written = offset + bytes;
+    }
+}
+
+CorpusIndexBuilder::CorpusIndexBuilder(int gram_length, bool rhythm_tokens)
+    : gram_length(gram_length), rhythm_tokens(rhythm_tokens) {
+    if (gram_length < 1 || gram_length > max_gram_length) {
+        throw std::runtime_error("Unsupported n-gram length: " + std::to_string(gram_length));
+    }
+}
+
+uint32_t CorpusIndexBuilder::add_reference(const std::string& name, const std::vector<NoteEvent>& notes) {
+    const uint32_t id = names.size();
+    names.push_back(name);
+    note_counts.push_back(notes.size());
+
+    std::vector<int> ref_intervals, buckets;
+    for (size_t i = 0; i < notes.size(); ++i) {
+        ref_intervals.push_back(i + 1 < notes.size() ? notes[i + 1].pitch - notes[i].pitch : 0);
+        buckets.push_back(rhythm_bucket(notes[i].note_value));
+        note_values.push_back(notes[i].note_value);
+    }
+    intervals.insert(intervals.end(), ref_intervals.begin(), ref_intervals.end());
+
+    const int interval_count = static_cast<int>(notes.size()) - 1;
+    for (int p = 0; p + gram_length <= interval_count; ++p) {
+        uint64_t key = gram_key(ref_intervals.data() + p,
+                                rhythm_tokens ? buckets.data() + p : nullptr, gram_length);
+        postings.push_back({key, id, static_cast<uint32_t>(p)});
+    }
+    return id;
+}
+
+void CorpusIndexBuilder::write(const std::string& path) const {
+    std::vector<Posting> sorted(postings);
+    std::sort(sorted.begin(), sorted.end(), [](const Posting& a, const Posting& b) {
+        if (a.key != b.key) return a.key < b.key;
+        if (a.reference != b.reference) return a.reference < b.reference;
+        return a.offset < b.offset;
+    });
+
+    std::vector<StoredKey> keys;
+    std::vector<StoredPosting> stored_postings;
+    stored_postings.reserve(sorted.size());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (i == 0 || sorted[i].key != sorted[i - 1].key) {
+            keys.push_back({sorted[i].key, static_cast<uint64_t>(i)});
+        }
+        stored_postings.push_back({sorted[i].reference, sorted[i].offset});
+    }
+    const uint64_t key_count = keys.size();
+    keys.push_back({0, static_cast<uint64_t>(sorted.size())});
+
+    std::vector<StoredReference> references;
+    std::string name_blob;
+    uint64_t first_note = 0;
+    for (size_t r = 0; r < names.size(); ++r) {
+        references.push_back({name_blob.size(), static_cast<uint32_t>(names[r].size()),
+                              note_counts[r], first_note});
+        name_blob += names[r];
+        first_note += note_counts[r];
+    }
+
+    CorpusHeader header{};
+    std::memcpy(header.magic, corpus_magic, sizeof(corpus_magic));
+    header.version = corpus_version;
+    header.byte_order = byte_order_mark;
+    header.gram_length = gram_length;
+    header.flags = rhythm_tokens ? flag_rhythm_tokens : 0;
+    header.reference_count = references.size();
+    header.note_count = note_values.size();
+    header.key_count = key_count;
+    header.posting_count = stored_postings.size();
+    header.references_offset = align8(sizeof(CorpusHeader));
+    header.names_offset = align8(header.references_offset + references.size() * sizeof(StoredReference));
+    header.names_size = name_blob.size();
+    header.intervals_offset = align8(header.names_offset + name_blob.size());
+    header.values_offset = align8(header.intervals_offset + intervals.size() * sizeof(int32_t));
+    header.keys_offset = align8(header.values_offset + note_values.size() * sizeof(double));
+    header.postings_offset = align8(header.keys_offset + keys.size() * sizeof(StoredKey));
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Failed to write corpus index: " + path);
+    }
+    uint64_t written = 0;
+    write_section(out, written, 0, &header, sizeof(header));
+    write_section(out, written, header.references_offset, references.data(),
+                  references.size() * sizeof(StoredReference));
+    write_section(out, written, header.names_offset, name_blob.data(), name_blob.size());
+    write_section(out, written, header.intervals_offset, intervals.data(),
+                  intervals.size() * sizeof(int32_t));
+    write_section(out, written, header.values_offset, note_values.data(),
+                  note_values.size() * sizeof(double));
+    write_section(out, written, header.keys_offset, keys.data(), keys.size() * sizeof(StoredKey));
+    write_section(out, written, header.postings_offset, stored_postings.data(),
+                  stored_postings.size() * sizeof(StoredPosting));
+    if (!out) {
+        throw std::runtime_error("Failed to write corpus index: " + path);
+    }
+}
+
+CorpusIndex CorpusIndex::open(const std::string& path) {
+    CorpusIndex index;
+    index.file = MappedFile(path);
+
+    const unsigned char* base = index.file.data();
+    const size_t size = index.file.size();
+    CorpusHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Truncated corpus index: " + path);
+    }
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, corpus_magic, sizeof(corpus_magic)) != 0) {
+        throw std::runtime_error("Not a corpus index: " + path);
+    }
+    if (header.version != corpus_version || header.byte_order != byte_order_mark) {
+        throw std::runtime_error("Unsupported corpus index version or byte order: " + path);
+    }
+    if (!section_fits(header.references_offset, header.reference_count, sizeof(StoredReference), size) ||
+        !section_fits(header.names_offset, header.names_size, 1, size) ||
+        !section_fits(header.intervals_offset, header.note_count, sizeof(int32_t), size) ||
+        !section_fits(header.values_offset, header.note_count, sizeof(double), size) ||
+        header.key_count == UINT64_MAX ||
+        !section_fits(header.keys_offset, header.key_count + 1, sizeof(StoredKey), size) ||
+        !section_fits(header.postings_offset, header.posting_count, sizeof(StoredPosting), size)) {
+        throw std::runtime_error("Truncated or misaligned corpus index: " + path);
+    }
+    if (header.gram_length < 1 || header.gram_length > uint32_t(max_gram_length)) {
+        throw std::runtime_error("Corrupt corpus index: " + path);
+    }
+
+    index.gram_length = header.gram_length;
+    index.rhythm_tokens = (header.flags & flag_rhythm_tokens) != 0;
+    index.reference_total = header.reference_count;
+    index.key_total = header.key_count;
+    index.references = base + header.references_offset;
+    index.names = reinterpret_cast<const char*>(base + header.names_offset);
+    index.intervals = reinterpret_cast<const int32_t*>(base + header.intervals_offset);
+    index.note_values = reinterpret_cast<const double*>(base + header.values_offset);
+    index.keys = base + header.keys_offset;
+    index.postings = base + header.postings_offset;
+
+    // query() indexes the note arrays through references and postings, so
+    // every stored index is checked once here.
+    const auto* refs = reinterpret_cast<const StoredReference*>(index.references);
+    for (uint64_t r = 0; r < header.reference_count; ++r) {
+        const StoredReference& ref = refs[r];
+        if (ref.name_offset > header.names_size ||
+            ref.name_length > header.names_size - ref.name_offset ||
+            ref.first_note > header.note_count ||
+            ref.note_count > header.note_count - ref.first_note) {
+            throw std::runtime_error("Corrupt corpus index: " + path);
+        }
+    }
+    const auto* keys = reinterpret_cast<const StoredKey*>(index.keys);
+    for (uint64_t k = 0; k < header.key_count; ++k) {
+        if ((k > 0 && keys[k].key <= keys[k - 1].key) ||
+            keys[k].first_posting > keys[k + 1].first_posting) {
+            throw std::runtime_error("Corrupt corpus index: " + path);
+        }
+    }
+    if (keys[0].first_posting != 0 || keys[header.key_count].first_posting != header.posting_count) {
+        throw std::runtime_error("Corrupt corpus index: " + path);
+    }
+    const auto* postings = reinterpret_cast<const StoredPosting*>(index.postings);
+    for (uint64_t i = 0; i < header.posting_count; ++i) {
+        const StoredPosting& hit = postings[i];
+        // The gram at `offset` must lie inside the reference's intervals.
+        if (hit.reference >= header.reference_count ||
+            uint64_t(hit.offset) + header.gram_length >= refs[hit.reference].note_count) {
+            throw std::runtime_error("Corrupt corpus index: " + path);
+        }
+    }
+    return index;
+}
+
+std::string CorpusIndex::reference_name(uint32_t id) const {
+    if (id >= reference_total) {
+        throw std::runtime_error("Unknown corpus reference: " + std::to_string(id));
+    }
+    const auto* ref = reinterpret_cast<const StoredReference*>(references) + id;
+    return std::string(names + ref->name_offset, ref->name_length);
+}
+
+std::vector<CorpusMatch> CorpusIndex::query(const std::vector<NoteEvent>& perf,
+                                            size_t max_results,
+                                            double similarity_threshold) const {
+    const int n = gram_length;
+    const int m = static_cast<int>(perf.size()) - 1;
+    std::vector<CorpusMatch> ranked;
+    if (m < n) return ranked;
+
+    std::vector<int> perf_intervals(m), perf_buckets(perf.size());
+    for (int i = 0; i < m; ++i) {
+        perf_intervals[i] = perf[i + 1].pitch - perf[i].pitch;
+    }
+    for (size_t i = 0; i < perf.size(); ++i) {
+        perf_buckets[i] = rhythm_bucket(perf[i].note_value);
+    }
+
+    const auto* stored_refs = reinterpret_cast<const StoredReference*>(references);
+    const auto* key_begin = reinterpret_cast<const StoredKey*>(keys);
+    const auto* key_end = key_begin + key_total;
+    const auto* posting_list = reinterpret_cast<const StoredPosting*>(postings);
+    std::unordered_map<uint32_t, CorpusMatch> by_reference;
+
+    for (int q = 0; q + n <= m; ++q) {
+        uint64_t key = gram_key(perf_intervals.data() + q,
+                                rhythm_tokens ? perf_buckets.data() + q : nullptr, n);
+        const StoredKey* entry = std::lower_bound(key_begin, key_end, key,
+            [](const StoredKey& k, uint64_t value) { return k.key < value; });
+        if (entry == key_end || entry->key != key) continue;
+
+        for (uint64_t i = entry->first_posting; i < (entry + 1)->first_posting; ++i) {
+            const StoredPosting& hit = posting_list[i];
+            const StoredReference& ref = stored_refs[hit.reference];
+            const int32_t* ref_intervals = intervals + ref.first_note;
+            const double* ref_values = note_values + ref.first_note;
+            const int ref_interval_count = static_cast<int>(ref.note_count) - 1;
+            const int p = hit.offset;
+
+            // A pair extends its run while both interval and, with rhythm
+            // tokens, duration bucket agree.
+            auto same_step = [&](int rp, int pq) {
+                if (ref_intervals[rp] != perf_intervals[pq]) return false;
+                return !rhythm_tokens ||
+                       rhythm_bucket(ref_values[rp + 1]) == perf_buckets[pq + 1];
+            };
+            auto same_start = [&](int rp, int pq) {
+                return !rhythm_tokens || rhythm_bucket(ref_values[rp]) == perf_buckets[pq];
+            };
+
+            // Reject hash collisions, then skip seeds inside a run that is
+            // reported from its first seed.
+            bool exact = same_start(p, q);
+            for (int t = 0; exact && t < n; ++t) exact = same_step(p + t, q + t);
+            if (!exact) continue;
+            if (p > 0 && q > 0 && same_step(p - 1, q - 1) && same_start(p - 1, q - 1)) continue;
+
+            int run = n;
+            while (p + run < ref_interval_count && q + run < m && same_step(p + run, q + run)) {
+                ++run;
+            }
+
+            const int length = run + 1;
+            int rhythm_matches = 0;
+            for (int k = 0; k < length; ++k) {
+                if (SegmentScoring::durations_match(ref_values[p + k], perf[q + k].note_value)) {
+                    ++rhythm_matches;
+                }
+            }
+            double sim = SegmentScoring::segment_score(length, rhythm_matches);
+            if (sim < similarity_threshold) continue;
+
+            CorpusMatch& match = by_reference[hit.reference];
+            match.reference_id = hit.reference;
+            match.segments.push_back({p, q, length, sim, 0.0});
+        }
+    }
+
+    for (auto& [id, match] : by_reference) {
+        match.name = reference_name(id);
+        match.best_similarity = 0.0;
+        match.matched_notes = 0;
+        for (const auto& seg : match.segments) {
+            match.best_similarity = std::max(match.best_similarity, seg.similarity);
+            match.matched_notes += seg.length;
+        }
+        std::sort(match.segments.begin(), match.segments.end(),
+            [](const MatchSegment& a, const MatchSegment& b) {
+                if (a.similarity != b.similarity) return a.similarity > b.similarity;
+                if (a.length != b.length) return a.length > b.length;
+                if (a.ref_start != b.ref_start) return a.ref_start < b.ref_start;
+                return a.perf_start < b.perf_start;
+            });
+        ranked.push_back(std::move(match));
+    }
+
+    std::sort(ranked.begin(), ranked.end(), [](const CorpusMatch& a, const CorpusMatch& b) {
+        if (a.best_similarity != b.best_similarity) return a.best_similarity > b.best_similarity;
+        if (a.matched_notes != b.matched_notes) return a.matched_notes > b.matched_notes;
+        return a.reference_id < b.reference_id;
+    });
+    if (ranked.size() > max_results) {
+        ranked.resize(max_results);
+    }
+    return ranked;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "common_defs.h"
+#include "mapped_file.h"
+#include "similarity_calculator.h"
+
+// Inverted index from interval n-grams to (reference, offset) postings over
+// a whole corpus of reference pieces. A query with one performance returns
+// the references that share passages with it, ranked, together with their
+// candidate segments. The file is memory-mapped read-only, so one index can
+// serve many processes at once.
+//
+// With rhythm tokens enabled, each n-gram key also folds in a coarse
+// duration bucket for every note it spans, so only passages that agree in
+// both pitch contour and rhythm produce postings.
+
+struct CorpusMatch {
+    uint32_t reference_id;
+    std::string name;
+    // Best segment similarity, then total matched notes, decide the rank.
+    double best_similarity;
+    int matched_notes;
+    std::vector<MatchSegment> segments;
+};
+
+class CorpusIndexBuilder {
+public:
+    explicit CorpusIndexBuilder(int gram_length = 4, bool rhythm_tokens = false);
+
+    uint32_t add_reference(const std::string& name, const std::vector<NoteEvent>& notes);
+    void write(const std::string& path) const;
+
+private:
+    struct Posting {
+        uint64_t key;
+        uint32_t reference;
+        uint32_t offset;
+    };
+
+    int gram_length;
+    bool rhythm_tokens;
+    std::vector<std::string> names;
+    std::vector<uint32_t> note_counts;
+    std::vector<int32_t> intervals;
+    std::vector<double> note_values;
+    std::vector<Posting> postings;
+};
+
+class CorpusIndex {
+public:
+    static CorpusIndex open(const std::string& path);
+
+    size_t reference_count() const { return reference_total; }
+    std::string reference_name(uint32_t id) const;
+
+    // References sharing at least one exact run with `perf`, best first.
+    // Segments are scored like SimilarityCalculator's exact candidates and
+    // kept when they reach `similarity_threshold`.
+    std::vector<CorpusMatch> query(const std::vector<NoteEvent>& perf,
+                                   size_t max_results,
+                                   double similarity_threshold) const;
+
+private:
+    MappedFile file;
+    int gram_length = 4;
+    bool rhythm_tokens = false;
+    size_t reference_total = 0;
+    size_t key_total = 0;
+    const unsigned char* references = nullptr;
+    const char* names = nullptr;
+    const int32_t* intervals = nullptr;
+    const double* note_values = nullptr;
+    const unsigned char* keys = nullptr;
+    const unsigned char* postings = nullptr;
+};
@@ -0,0 +1,75 @@
+#include "interval_kernels.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NNOTE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    [[maybe_unused]] uint32_t equality_mask_scalar(const int8_t* a, const int8_t* b) {
+        uint32_t mask = 0;
+        for (int k = 0; k < IntervalKernels::lanes; ++k) {
+            mask |= static_cast<uint32_t>(a[k] == b[k]) << k;
+        }
+        return mask;
+    }
+
+#ifdef NNOTE_X86_KERNELS
+    uint32_t equality_mask_sse2(const int8_t* a, const int8_t* b) {
+        __m128i lo = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+        __m128i hi = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 16)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 16)));
+        return static_cast<uint32_t>(_mm_movemask_epi8(lo)) |
+               (static_cast<uint32_t>(_mm_movemask_epi8(hi)) << 16);
+    }
+
+    __attribute__((target("avx2")))
+    uint32_t equality_mask_avx2(const int8_t* a, const int8_t* b) {
+        __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+    }
+#endif
+
+    struct Kernel {
+        IntervalKernels::EqualityMaskFn fn;
+        const char* name;
+    };
+
+    Kernel select_kernel() {
+#ifdef NNOTE_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return {equality_mask_avx2, "avx2"};
+        }
+        return {equality_mask_sse2, "sse2"};
+#else
+        return {equality_mask_scalar, "scalar"};
+#endif
+    }
+
+    const Kernel& active_kernel() {
+        static const Kernel kernel = select_kernel();
+        return kernel;
+    }
+}
+
+namespace IntervalKernels {
+    EqualityMaskFn equality_mask() {
+        return active_kernel().fn;
+    }
+
+    const char* kernel_name() {
+        return active_kernel().name;
+    }
+
+    void pack(const int* intervals, size_t count, std::vector<int8_t>& packed) {
+        packed.clear();
+        packed.reserve(count + lanes);
+        for (size_t k = 0; k < count; ++k) {
+            packed.push_back(static_cast<int8_t>(intervals[k]));
+        }
+        packed.insert(packed.end(), lanes, 0);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Packed int8 interval comparison for the diagonal exact-match pass. Pitch
+// intervals always fit in int8, so 32 of them share one AVX2 register. The
+// widest kernel the CPU supports is chosen once at runtime (AVX2, SSE2, or
+// portable scalar code off x86-64).
+namespace IntervalKernels {
+    constexpr int lanes = 32;
+
+    // Bit k is set when a[k] == b[k], for k in [0, 32).
+    using EqualityMaskFn = uint32_t (*)(const int8_t* a, const int8_t* b);
+
+    // Index of the lowest set bit; 32 when x is zero.
+    inline int trailing_zeros(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return x == 0 ? 32 : __builtin_ctz(x);
+#else
+        int n = 0;
+        while (n < 32 && !(x & (uint32_t(1) << n))) ++n;
+        return n;
+#endif
+    }
+
+    EqualityMaskFn equality_mask();
+    const char* kernel_name();
+
+    // Narrows intervals[0 .. count) to int8 and appends `lanes` bytes of
+    // padding so a full-width load never reads past the end. Intervals
+    // between MIDI key numbers always fit.
+    void pack(const int* intervals, size_t count, std::vector<int8_t>& packed);
+}
@@ -1,6 +1,12 @@
 #include "midi_io.h"
+#include "metrics.h"
 #include "tinyfiledialogs.h"
 #include "similarity_calculator.h"
+#include "batch_runner.h"
+#include "corpus_index.h"
+#include "reference_index.h"
+#include "streaming_matcher.h"
+#include "trace.h"
 #include <iostream>
 #include <iomanip>
 #include <vector>
@@ -16,9 +22,120 @@ std::string select_midi_file(const std::string& dialog_title);
 std::vector<NoteEvent> parse_midi_with_retry(const std::string& path);
 void generate_similarity_report(const std::vector<MatchSegment>& segments, bool fallback_triggered);
 void run_alignment_process();
-void save_segment_to_midi(const std::vector<NoteEvent>& notes, const std::string& filename);
 
-int main() {
+template <typename Scoring>
+int run_stream(const std::string& ref_path, const std::string& perf_path, double threshold) {
+    BasicStreamingMatcher<Scoring> matcher(MIDIIO::parse_midi_sequence(ref_path), threshold);
+    std::chrono::nanoseconds total{0};
+    for (const auto& note : MIDIIO::parse_midi(perf_path)) {
+        matcher.push(note, [&](const MatchSegment& seg) {
+            std::cout << std::fixed << std::setprecision(1)
+                      << "[note " << matcher.notes_seen() << "] ref " << seg.ref_start
+                      << " perf " << seg.perf_start << " len " << seg.length
+                      << " " << seg.similarity << "%\n";
+        });
+        total += matcher.last_latency();
+    }
+    if (matcher.notes_seen() > 0) {
+        std::cout << "[Stream] " << matcher.notes_seen() << " notes, mean "
+                  << total.count() / matcher.notes_seen() << " ns, max "
+                  << matcher.max_latency().count() << " ns per note\n";
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Precompute a reference once: n-note --index <reference.mid> <reference.nnidx>
+    if (argc == 4 && std::string(argv[1]) == "--index") {
+        try {
+            ReferenceIndex::write(argv[3], MIDIIO::parse_midi(argv[2]));
+            std::cout << "[Index] Saved: " << argv[3] << "\n";
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "\n[Fatal Error] " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // Corpus search: n-note --corpus-build <corpus.nncorp> <dir|manifest> [--rhythm]
+    //                n-note --corpus-query <corpus.nncorp> <performance.mid> [top]
+    if (argc >= 4 && std::string(argv[1]) == "--corpus-build") {
+        try {
+            bool rhythm = argc >= 5 && std::string(argv[4]) == "--rhythm";
+            CorpusIndexBuilder builder(4, rhythm);
+            for (const auto& path : BatchRunner::collect_midi_paths(argv[3])) {
+                try {
+                    builder.add_reference(path, MIDIIO::parse_midi(path));
+                } catch (const std::exception& e) {
+                    std::cerr << "[Corpus] Skipped " << path << ": " << e.what() << "\n";
+                }
+            }
+            builder.write(argv[2]);
+            std::cout << "[Corpus] Saved: " << argv[2] << "\n";
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "\n[Fatal Error] " << e.what() << "\n";
+            return 1;
+        }
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--corpus-query") {
+        try {
+            CorpusIndex corpus = CorpusIndex::open(argv[2]);
+            size_t top = argc >= 5 ? std::stoul(argv[4]) : 10;
+            for (const auto& match : corpus.query(MIDIIO::parse_midi(argv[3]), top, 70.0)) {
+                std::cout << std::fixed << std::setprecision(1)
+                          << match.best_similarity << "%\t" << match.matched_notes << "\t"
+                          << match.name << "\n";
+                for (const auto& seg : match.segments) {
+                    std::cout << "\t" << seg.ref_start << "\t" << seg.perf_start << "\t"
+                              << seg.length << "\t" << seg.similarity << "%\n";
+                }
+            }
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "\n[Fatal Error] " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // Live scoring replay: n-note --stream <reference.mid> <performance.mid> [threshold]
+    //                                      [standard|strict|lenient]
+    if (argc >= 4 && std::string(argv[1]) == "--stream") {
+        try {
+            double threshold = argc >= 5 ? std::stod(argv[4]) : 70.0;
+            auto profile = argc >= 6 ? SegmentScoring::profile_from_name(argv[5])
+                                     : SegmentScoring::Profile::Standard;
+            switch (profile) {
+            case SegmentScoring::Profile::StrictRhythm:
+                return run_stream<SegmentScoring::StrictRhythm>(argv[2], argv[3], threshold);
+            case SegmentScoring::Profile::Lenient:
+                return run_stream<SegmentScoring::Lenient>(argv[2], argv[3], threshold);
+            default:
+                return run_stream<SegmentScoring::Standard>(argv[2], argv[3], threshold);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "\n[Fatal Error] " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // Headless grading: n-note --batch <reference.mid> <dir|manifest> [report.tsv] [threads]
+    //                                 [standard|strict|lenient]
+    if (argc >= 4 && std::string(argv[1]) == "--batch") {
+        BatchOptions options;
+        options.reference_path = argv[2];
+        options.performances = argv[3];
+        if (argc >= 5) options.report_path = argv[4];
+        if (argc >= 6) options.threads = std::stoul(argv[5]);
+        try {
+            if (argc >= 7) options.profile = SegmentScoring::profile_from_name(argv[6]);
+            return BatchRunner::run_batch_process(options) == 0 ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << "\n[Fatal Error] " << e.what() << "\n";
+            return 1;
+        }
+    }
+
     run_alignment_process();
     std::cout << "\npress enter to exit...";
     std::cin.get();  
@@ -74,36 +191,6 @@ void generate_similarity_report(
 }
 
 
-void save_segment_to_midi(const std::vector<NoteEvent>& notes, const std::string& filename) {
-    if (notes.empty()) return;
-
-    smf::MidiFile midifile;
-    midifile.setTicksPerQuarterNote(480);
-    int track = 0;
-    midifile.addTrack(1);
-
-    midifile.addTempo(track, 0, notes[0].bpm);
-
-    double start_offset = notes[0].start;
-
-    for (const auto& note : notes) {
-        double relative_start_sec = note.start - start_offset;
-        
-        int start_tick = static_cast<int>(relative_start_sec * (note.bpm / 60.0) * 480.0);
-        int duration_tick = static_cast<int>(note.note_value * 480.0);
-
-        midifile.addNoteOn(track, start_tick, note.channel, note.pitch, 90);
-        midifile.addNoteOff(track, start_tick + duration_tick, note.channel, note.pitch);
-    }
-
-    midifile.sortTracks();
-    if (midifile.write(filename)) {
-        std::cout << "[Export] Saved: " << filename << std::endl;
-    } else {
-        std::cerr << "[Export Error] Failed to write: " << filename << std::endl;
-    }
-}
-
 std::vector<double> calculate_denominators(
     const std::string& path, 
     const std::vector<NoteEvent>& notes
@@ -145,7 +232,9 @@ void run_alignment_process() {
                   << perf_notes.size() << "\n"
                   << "===========================================\n";
 
-        SimilarityCalculator calculator(ref_notes, perf_notes);
+        const NoteSequence ref_sequence(ref_notes);
+        const NoteSequence perf_sequence(perf_notes);
+        SimilarityCalculator calculator(ref_sequence, perf_sequence);
         std::vector<MatchSegment> segments = calculator.find_similar_segments(70.0);
         bool fallback_triggered = calculator.was_fallback_used();
         
@@ -169,14 +258,22 @@ void run_alignment_process() {
                 std::string ref_out_name = ref_base + "_seg" + std::to_string(seg_index) + "_ref.mid";
                 std::string perf_out_name = perf_base + "_seg" + std::to_string(seg_index) + "_perf.mid";
 
-                save_segment_to_midi(ref_sub, ref_out_name);
-                save_segment_to_midi(perf_sub, perf_out_name);
+                MIDIIO::save_segment_to_midi(ref_sub, ref_out_name);
+                MIDIIO::save_segment_to_midi(perf_sub, perf_out_name);
+                NNOTE_COUNT(MetricCounter::SegmentsExported, 2);
                 
                 seg_index++;
             }
         }
         std::cout << "===========================================\n";
 
+#ifdef NNOTE_ENABLE_METRICS
+        // One snapshot per run, in both formats, next to the exported segments.
+        Metrics::write_report(perf_base + "_metrics.json");
+        Metrics::write_report(perf_base + "_metrics.prom");
+        std::cout << "[Metrics] Saved: " << perf_base << "_metrics.json / .prom\n";
+#endif
+
     } catch (const std::exception& e) {
         std::cerr << "\n[Fatal Error] " << e.what() << "\n";
     }
@@ -0,0 +1,98 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to stat file: " + path);
+    }
+    length = static_cast<size_t>(file_size.QuadPart);
+    file_handle = file;
+    if (length == 0) return;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        release();
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+    mapping_handle = mapping;
+    bytes = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes) {
+        release();
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file: " + path);
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+        void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+        bytes = static_cast<const unsigned char*>(addr);
+    }
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+#ifdef _WIN32
+        std::swap(file_handle, other.file_handle);
+        std::swap(mapping_handle, other.mapping_handle);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::release() {
+#ifdef _WIN32
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mapping_handle) CloseHandle(mapping_handle);
+    if (file_handle) CloseHandle(file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    if (bytes) munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+    bytes = nullptr;
+    length = 0;
+}
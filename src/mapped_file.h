@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are loaded on first touch,
+// so opening a large index costs almost nothing until it is read.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+
+    void release();
+};
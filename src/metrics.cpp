@@ -0,0 +1,89 @@
+#include "metrics.h"
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    constexpr int stage_count = static_cast<int>(MetricStage::Count);
+    constexpr int counter_count = static_cast<int>(MetricCounter::Count);
+
+    const char* const stage_names[stage_count] = {
+        "smf_parse", "time_analysis", "interval_dp",
+        "fallback_search", "overlap_resolution", "midi_export"
+    };
+    const char* const counter_names[counter_count] = {
+        "notes_parsed", "dp_cells", "candidates", "fallback_probes", "segments_exported"
+    };
+
+    std::atomic<uint64_t> stage_nanoseconds[stage_count] = {};
+    std::atomic<uint64_t> stage_calls[stage_count] = {};
+    std::atomic<uint64_t> counters[counter_count] = {};
+}
+
+namespace Metrics {
+    void add_time(MetricStage stage, uint64_t nanoseconds) {
+        stage_nanoseconds[static_cast<int>(stage)].fetch_add(nanoseconds, std::memory_order_relaxed);
+        stage_calls[static_cast<int>(stage)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void add(MetricCounter counter, uint64_t amount) {
+        counters[static_cast<int>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (int i = 0; i < stage_count; ++i) {
+            stage_nanoseconds[i].store(0);
+            stage_calls[i].store(0);
+        }
+        for (int i = 0; i < counter_count; ++i) {
+            counters[i].store(0);
+        }
+    }
+
+    std::string to_json() {
+        std::ostringstream out;
+        out << "{\n  \"stages\": {\n";
+        for (int i = 0; i < stage_count; ++i) {
+            out << "    \"" << stage_names[i] << "\": {\"seconds\": "
+                << stage_nanoseconds[i].load() / 1e9
+                << ", \"calls\": " << stage_calls[i].load() << "}"
+                << (i + 1 < stage_count ? ",\n" : "\n");
+        }
+        out << "  },\n  \"counters\": {\n";
+        for (int i = 0; i < counter_count; ++i) {
+            out << "    \"" << counter_names[i] << "\": " << counters[i].load()
+                << (i + 1 < counter_count ? ",\n" : "\n");
+        }
+        out << "  }\n}\n";
+        return out.str();
+    }
+
+    std::string to_prometheus() {
+        std::ostringstream out;
+        out << "# TYPE nnote_stage_seconds_total counter\n";
+        for (int i = 0; i < stage_count; ++i) {
+            out << "nnote_stage_seconds_total{stage=\"" << stage_names[i] << "\"} "
+                << stage_nanoseconds[i].load() / 1e9 << "\n";
+        }
+        out << "# TYPE nnote_stage_calls_total counter\n";
+        for (int i = 0; i < stage_count; ++i) {
+            out << "nnote_stage_calls_total{stage=\"" << stage_names[i] << "\"} "
+                << stage_calls[i].load() << "\n";
+        }
+        for (int i = 0; i < counter_count; ++i) {
+            out << "# TYPE nnote_" << counter_names[i] << "_total counter\n"
+                << "nnote_" << counter_names[i] << "_total " << counters[i].load() << "\n";
+        }
+        return out.str();
+    }
+
+    void write_report(const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("Failed to write metrics: " + path);
+        }
+        const bool prometheus = path.size() >= 5 && path.compare(path.size() - 5, 5, ".prom") == 0;
+        out << (prometheus ? to_prometheus() : to_json());
+    }
+}
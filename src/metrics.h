@@ -0,0 +1,69 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Per-stage timers and work counters for finding where a slow job spent its
+// time. Like NNOTE_TRACE, every NNOTE_TIME_STAGE / NNOTE_COUNT statement
+// compiles to nothing unless the build defines NNOTE_ENABLE_METRICS. When
+// compiled in, each one is a relaxed atomic add into a fixed slot, and the
+// totals can be dumped as JSON or Prometheus text.
+
+// SmfParse covers all of parse_midi, including its TimeAnalysis part.
+enum class MetricStage {
+    SmfParse,
+    TimeAnalysis,
+    IntervalDP,
+    FallbackSearch,
+    OverlapResolution,
+    MidiExport,
+    Count
+};
+
+enum class MetricCounter {
+    NotesParsed,
+    DpCells,
+    Candidates,
+    FallbackProbes,
+    SegmentsExported,
+    Count
+};
+
+namespace Metrics {
+    void add_time(MetricStage stage, uint64_t nanoseconds);
+    void add(MetricCounter counter, uint64_t amount);
+    void reset();
+
+    std::string to_json();
+    std::string to_prometheus();
+    // Prometheus text for a .prom path, JSON otherwise.
+    void write_report(const std::string& path);
+}
+
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(MetricStage stage)
+        : stage(stage), started(std::chrono::steady_clock::now()) {}
+    ~ScopedStageTimer() {
+        Metrics::add_time(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count());
+    }
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    MetricStage stage;
+    std::chrono::steady_clock::time_point started;
+};
+
+#define NNOTE_METRICS_CONCAT_(a, b) a##b
+#define NNOTE_METRICS_CONCAT(a, b) NNOTE_METRICS_CONCAT_(a, b)
+
+#ifdef NNOTE_ENABLE_METRICS
+#define NNOTE_TIME_STAGE(stage) \
+    ScopedStageTimer NNOTE_METRICS_CONCAT(nnote_stage_timer_, __LINE__)(stage)
+#define NNOTE_COUNT(counter, amount) Metrics::add((counter), static_cast<uint64_t>(amount))
+#else
+#define NNOTE_TIME_STAGE(stage) do { } while (0)
+#define NNOTE_COUNT(counter, amount) do { } while (0)
+#endif
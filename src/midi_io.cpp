@@ -1,21 +1,31 @@
 #include "midi_io.h"
 #include "MidiFile.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
 #include <stdexcept>
 #include <algorithm>
 #include <vector>
 #include <map>
-#include <iostream>
 
 using namespace smf;
 
 namespace MIDIIO {
     std::vector<NoteEvent> parse_midi(const std::string& path) {
+        return parse_midi_sequence(path).to_events();
+    }
+
+    NoteSequence parse_midi_sequence(const std::string& path) {
+        NNOTE_TIME_STAGE(MetricStage::SmfParse);
         MidiFile midi;
         if (!midi.read(path)) {
             throw std::runtime_error("Failed to read MIDI file: " + path);
         }
-        midi.doTimeAnalysis();
-        midi.linkNotePairs();
+        {
+            NNOTE_TIME_STAGE(MetricStage::TimeAnalysis);
+            midi.doTimeAnalysis();
+            midi.linkNotePairs();
+        }
 
         std::vector<std::pair<double, double>> tempo_events;
         for (int track = 0; track < midi.getNumTracks(); ++track) {
@@ -46,12 +56,12 @@ namespace MIDIIO {
             }
         }
 
-        std::vector<NoteEvent> notes;
+        NoteSequence notes;
         double channel_time_offset = 0.0;
         constexpr double REST_DURATION = 10.0;
 
         for (auto& [channel_num, events] : channel_notes) {
-            std::cout << "\n=== channel " << channel_num;
+            NNOTE_TRACE(TraceCategory::Parse, TraceLevel::Info, "=== channel " << channel_num);
 
             std::sort(events.begin(), events.end(),
                 [](const MidiEvent* a, const MidiEvent* b) {
@@ -92,6 +102,38 @@ namespace MIDIIO {
         if (notes.empty()) {
             throw std::runtime_error("No valid notes found in MIDI file");
         }
+        NNOTE_COUNT(MetricCounter::NotesParsed, notes.size());
         return notes;
     }
+
+    void save_segment_to_midi(const std::vector<NoteEvent>& notes, const std::string& filename) {
+        if (notes.empty()) return;
+        NNOTE_TIME_STAGE(MetricStage::MidiExport);
+
+        smf::MidiFile midifile;
+        midifile.setTicksPerQuarterNote(480);
+        int track = 0;
+        midifile.addTrack(1);
+
+        midifile.addTempo(track, 0, notes[0].bpm);
+
+        double start_offset = notes[0].start;
+
+        for (const auto& note : notes) {
+            double relative_start_sec = note.start - start_offset;
+        
+            int start_tick = static_cast<int>(relative_start_sec * (note.bpm / 60.0) * 480.0);
+            int duration_tick = static_cast<int>(note.note_value * 480.0);
+
+            midifile.addNoteOn(track, start_tick, note.channel, note.pitch, 90);
+            midifile.addNoteOff(track, start_tick + duration_tick, note.channel, note.pitch);
+        }
+
+        midifile.sortTracks();
+        if (midifile.write(filename)) {
+            NNOTE_TRACE(TraceCategory::Export, TraceLevel::Info, "[Export] Saved: " << filename);
+        } else {
+            std::cerr << "[Export Error] Failed to write: " << filename << std::endl;
+        }
+    }
 }
\ No newline at end of file
@@ -2,7 +2,12 @@
 #include <string>
 #include <vector>
 #include "common_defs.h" 
+#include "note_sequence.h"
 
 namespace MIDIIO {
     std::vector<NoteEvent> parse_midi(const std::string& path);
+    // Same notes, stored column-wise for the matchers.
+    NoteSequence parse_midi_sequence(const std::string& path);
+    // Writes the notes as a single-track file starting at tick 0.
+    void save_segment_to_midi(const std::vector<NoteEvent>& notes, const std::string& filename);
 }
\ No newline at end of file
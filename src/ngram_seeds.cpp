@@ -0,0 +1,79 @@
+#include "ngram_seeds.h"
+#include <algorithm>
+
+namespace {
+    constexpr uint64_t hash_base = 0x100000001b3ULL;
+
+    uint64_t symbol(int v) {
+        // Keep zero intervals (repeated pitches) from hashing to zero.
+        return static_cast<uint64_t>(static_cast<int64_t>(v)) + 0x9e3779b97f4a7c15ULL;
+    }
+
+    size_t table_size_for(size_t entries) {
+        size_t size = 16;
+        while (size < entries * 2) size <<= 1;
+        return size;
+    }
+}
+
+namespace NgramSeeds {
+    RollingHash::RollingHash(int k) : k(k) {
+        for (int i = 1; i < k; ++i) top_power *= hash_base;
+    }
+
+    uint64_t RollingHash::init(const int* values) {
+        hash = 0;
+        for (int i = 0; i < k; ++i) {
+            hash = hash * hash_base + symbol(values[i]);
+        }
+        return hash;
+    }
+
+    uint64_t RollingHash::roll(int out, int in) {
+        hash = (hash - symbol(out) * top_power) * hash_base + symbol(in);
+        return hash;
+    }
+
+    std::vector<ExactRun> maximal_common_runs(const int* a, int n,
+                                              const std::vector<int>& b,
+                                              int k) {
+        std::vector<ExactRun> runs;
+        const int m = b.size();
+        if (k < 1 || n < k || m < k) return runs;
+
+        // Chained hash table over a's k-grams: head[bucket] is the latest
+        // position in that bucket and next[] links to the earlier ones.
+        const int grams = n - k + 1;
+        const size_t table_size = table_size_for(grams);
+        const size_t mask = table_size - 1;
+        std::vector<int> head(table_size, -1);
+        std::vector<int> next(grams, -1);
+        std::vector<uint64_t> gram_hash(grams);
+
+        RollingHash hasher(k);
+        for (int p = 0; p < grams; ++p) {
+            uint64_t h = (p == 0) ? hasher.init(a) : hasher.roll(a[p - 1], a[p + k - 1]);
+            gram_hash[p] = h;
+            size_t bucket = (h ^ (h >> 29)) & mask;
+            next[p] = head[bucket];
+            head[bucket] = p;
+        }
+
+        for (int q = 0; q + k <= m; ++q) {
+            uint64_t h = (q == 0) ? hasher.init(b.data()) : hasher.roll(b[q - 1], b[q + k - 1]);
+            size_t bucket = (h ^ (h >> 29)) & mask;
+            for (int p = head[bucket]; p != -1; p = next[p]) {
+                if (gram_hash[p] != h) continue;
+                if (p > 0 && q > 0 && a[p - 1] == b[q - 1]) continue;
+                if (!std::equal(a + p, a + p + k, b.begin() + q)) continue;
+
+                int length = k;
+                while (p + length < n && q + length < m && a[p + length] == b[q + length]) {
+                    ++length;
+                }
+                runs.push_back({p, q, length});
+            }
+        }
+        return runs;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "suffix_array.h"
+
+namespace NgramSeeds {
+    // Rabin-Karp hash of k consecutive values, updated in O(1) per step.
+    class RollingHash {
+    public:
+        explicit RollingHash(int k);
+
+        // Hash of values[start .. start + k).
+        uint64_t init(const int* values);
+        // Slides the window one step: drops `out`, appends `in`.
+        uint64_t roll(int out, int in);
+        uint64_t value() const { return hash; }
+
+    private:
+        int k;
+        uint64_t top_power = 1;
+        uint64_t hash = 0;
+    };
+
+    // Every maximal run of at least `k` values shared by a[0 .. n) and `b`. A
+    // hash table of a's k-grams, sized from `a`, is probed with each k-gram of
+    // `b`; hits that can be extended to the left are interior to a run
+    // reported from its first seed and are skipped, the rest are extended to
+    // the right. Runs in O(n + m + hits).
+    std::vector<ExactRun> maximal_common_runs(const int* a, int n,
+                                              const std::vector<int>& b,
+                                              int k);
+}
@@ -0,0 +1,62 @@
+#include "note_sequence.h"
+#include <stdexcept>
+#include <string>
+
+NoteSequence::NoteSequence(const std::vector<NoteEvent>& events) {
+    reserve(events.size());
+    for (const auto& note : events) {
+        push_back(note);
+    }
+}
+
+void NoteSequence::reserve(size_t count) {
+    pitch.reserve(count);
+    onset.reserve(count);
+    duration.reserve(count);
+    tempo.reserve(count);
+    channel.reserve(count);
+}
+
+void NoteSequence::push_back(const NoteEvent& note) {
+    if (note.pitch < 0 || note.pitch > 127) {
+        throw std::runtime_error("Pitch is not a MIDI key number: " + std::to_string(note.pitch));
+    }
+    pitch.push_back(static_cast<int8_t>(note.pitch));
+    onset.push_back(note.start);
+    duration.push_back(note.note_value);
+    tempo.push_back(note.bpm);
+    channel.push_back(static_cast<uint8_t>(note.channel));
+}
+
+NoteEvent NoteSequence::at(size_t i) const {
+    return {onset[i], pitch[i], duration[i], tempo[i], channel[i]};
+}
+
+NoteColumns NoteSequence::columns() const {
+    return {pitch.data(), onset.data(), duration.data(), tempo.data(), channel.data(), size()};
+}
+
+std::vector<NoteEvent> NoteSequence::to_events() const {
+    std::vector<NoteEvent> events;
+    events.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        events.push_back(at(i));
+    }
+    return events;
+}
+
+NoteEvent NoteColumns::at(size_t i) const {
+    return {onset[i], pitch[i], duration[i], tempo[i], channel[i]};
+}
+
+std::vector<int> NoteSequence::intervals() const {
+    std::vector<int> result;
+    if (size() < 2) {
+        return result;
+    }
+    result.reserve(size() - 1);
+    for (size_t i = 1; i < size(); ++i) {
+        result.push_back(pitch[i] - pitch[i - 1]);
+    }
+    return result;
+}
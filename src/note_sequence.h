@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "common_defs.h"
+
+// Read-only view of note columns stored elsewhere: a NoteSequence, or the
+// column sections of a memory-mapped reference index. Member names match
+// NoteSequence so matching code reads the same against either.
+struct NoteColumns {
+    const int8_t* pitch = nullptr;
+    const double* onset = nullptr;
+    const double* duration = nullptr;
+    const double* tempo = nullptr;
+    const uint8_t* channel = nullptr;
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    NoteEvent at(size_t i) const;
+};
+
+// Read-only view of an interval array.
+struct IntervalView {
+    const int* values = nullptr;
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    const int* data() const { return values; }
+    int operator[](size_t i) const { return values[i]; }
+};
+
+// Column-wise (structure-of-arrays) storage for a note list. Each matching
+// pass touches only the column it needs: the interval pass streams one byte
+// per pitch and the rhythm pass eight bytes per duration, where a NoteEvent
+// row costs 40 bytes either way. MIDI key numbers and channels fit in a byte,
+// so every pitch interval fits in int8 as well.
+struct NoteSequence {
+    std::vector<int8_t> pitch;
+    std::vector<double> onset;
+    std::vector<double> duration;   // NoteEvent::note_value, in quarter notes
+    std::vector<double> tempo;      // NoteEvent::bpm
+    std::vector<uint8_t> channel;
+
+    NoteSequence() = default;
+    // Copies every note; explicit so the O(n) conversion shows at call sites.
+    explicit NoteSequence(const std::vector<NoteEvent>& events);
+
+    size_t size() const { return pitch.size(); }
+    bool empty() const { return pitch.empty(); }
+
+    void reserve(size_t count);
+    // Throws if the pitch is not a MIDI key number (0-127).
+    void push_back(const NoteEvent& note);
+    NoteEvent at(size_t i) const;
+    std::vector<NoteEvent> to_events() const;
+    // Valid until the sequence is modified or destroyed.
+    NoteColumns columns() const;
+
+    // pitch[i + 1] - pitch[i] for every adjacent pair.
+    std::vector<int> intervals() const;
+};
@@ -0,0 +1,151 @@
+#include "reference_index.h"
+#include "suffix_array.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    constexpr char index_magic[8] = {'N', 'N', 'R', 'E', 'F', 'I', 'D', 'X'};
+    constexpr uint32_t index_version = 2;
+    constexpr uint32_t byte_order_mark = 0x01020304;
+
+    struct IndexHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t note_count;
+        uint64_t interval_count;
+        uint64_t pitch_offset;
+        uint64_t onset_offset;
+        uint64_t duration_offset;
+        uint64_t tempo_offset;
+        uint64_t channel_offset;
+        uint64_t intervals_offset;
+        uint64_t suffix_array_offset;
+    };
+    static_assert(sizeof(int) == sizeof(int32_t), "intervals are stored as int32");
+
+    uint64_t align8(uint64_t offset) {
+        return (offset + 7) & ~uint64_t(7);
+    }
+
+    // True when `count` elements of `width` bytes at `offset` lie inside a
+    // file of `size` bytes, starting on an 8-byte boundary. Written so that
+    // no product or sum can wrap.
+    bool section_fits(uint64_t offset, uint64_t count, uint64_t width, uint64_t size) {
+        return offset % 8 == 0 && offset <= size && count <= (size - offset) / width;
+    }
+
+    // Writes one column and pads it to the next 8-byte boundary.
+    template <typename T>
+    void write_section(std::ofstream& out, const std::vector<T>& values) {
+        static const char zeros[8] = {};
+        const uint64_t bytes = values.size() * sizeof(T);
+        out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(bytes));
+        out.write(zeros, static_cast<std::streamsize>(align8(bytes) - bytes));
+    }
+}
+
+void ReferenceIndex::write(const std::string& path, const std::vector<NoteEvent>& notes) {
+    const NoteSequence sequence(notes);
+    std::vector<int> intervals = sequence.intervals();
+    std::vector<int> sa = SuffixArray::build_from_values(intervals);
+
+    IndexHeader header{};
+    std::memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.version = index_version;
+    header.byte_order = byte_order_mark;
+    header.note_count = notes.size();
+    header.interval_count = intervals.size();
+    header.pitch_offset = align8(sizeof(IndexHeader));
+    header.onset_offset = header.pitch_offset + align8(notes.size() * sizeof(int8_t));
+    header.duration_offset = header.onset_offset + align8(notes.size() * sizeof(double));
+    header.tempo_offset = header.duration_offset + align8(notes.size() * sizeof(double));
+    header.channel_offset = header.tempo_offset + align8(notes.size() * sizeof(double));
+    header.intervals_offset = header.channel_offset + align8(notes.size() * sizeof(uint8_t));
+    header.suffix_array_offset = header.intervals_offset + align8(intervals.size() * sizeof(int32_t));
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Failed to write reference index: " + path);
+    }
+    static const char zeros[8] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(zeros, static_cast<std::streamsize>(header.pitch_offset - sizeof(header)));
+    write_section(out, sequence.pitch);
+    write_section(out, sequence.onset);
+    write_section(out, sequence.duration);
+    write_section(out, sequence.tempo);
+    write_section(out, sequence.channel);
+    write_section(out, intervals);
+    write_section(out, sa);
+    if (!out) {
+        throw std::runtime_error("Failed to write reference index: " + path);
+    }
+}
+
+ReferenceIndex ReferenceIndex::open(const std::string& path) {
+    ReferenceIndex index;
+    index.file = MappedFile(path);
+
+    const unsigned char* base = index.file.data();
+    const size_t size = index.file.size();
+    IndexHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Truncated reference index: " + path);
+    }
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0) {
+        throw std::runtime_error("Not a reference index: " + path);
+    }
+    if (header.version != index_version || header.byte_order != byte_order_mark) {
+        throw std::runtime_error("Unsupported reference index version or byte order: " + path);
+    }
+    const uint64_t n = header.note_count;
+    const uint64_t intervals = header.interval_count;
+    if (n == 0 ? intervals != 0 : intervals != n - 1) {
+        throw std::runtime_error("Corrupt reference index: " + path);
+    }
+    if (!section_fits(header.pitch_offset, n, sizeof(int8_t), size) ||
+        !section_fits(header.onset_offset, n, sizeof(double), size) ||
+        !section_fits(header.duration_offset, n, sizeof(double), size) ||
+        !section_fits(header.tempo_offset, n, sizeof(double), size) ||
+        !section_fits(header.channel_offset, n, sizeof(uint8_t), size) ||
+        !section_fits(header.intervals_offset, intervals, sizeof(int32_t), size) ||
+        !section_fits(header.suffix_array_offset, intervals, sizeof(int32_t), size)) {
+        throw std::runtime_error("Truncated or misaligned reference index: " + path);
+    }
+
+    NoteColumns& columns = index.note_columns;
+    columns.count = n;
+    columns.pitch = reinterpret_cast<const int8_t*>(base + header.pitch_offset);
+    columns.onset = reinterpret_cast<const double*>(base + header.onset_offset);
+    columns.duration = reinterpret_cast<const double*>(base + header.duration_offset);
+    columns.tempo = reinterpret_cast<const double*>(base + header.tempo_offset);
+    columns.channel = base + header.channel_offset;
+    index.interval_total = header.interval_count;
+    index.interval_data = reinterpret_cast<const int32_t*>(base + header.intervals_offset);
+    index.suffix_data = reinterpret_cast<const int32_t*>(base + header.suffix_array_offset);
+
+    // Matching indexes notes by interval position and intervals by suffix
+    // array entry, so every stored value is checked once here.
+    for (uint64_t i = 0; i < n; ++i) {
+        if (columns.pitch[i] < 0) {
+            throw std::runtime_error("Corrupt reference index: " + path);
+        }
+    }
+    for (uint64_t i = 0; i < intervals; ++i) {
+        const int32_t entry = index.suffix_data[i];
+        if (index.interval_data[i] != columns.pitch[i + 1] - columns.pitch[i] ||
+            entry < 0 || static_cast<uint64_t>(entry) >= intervals) {
+            throw std::runtime_error("Corrupt reference index: " + path);
+        }
+    }
+    return index;
+}
+
+bool ReferenceIndex::is_index_path(const std::string& path) {
+    const std::string ext = ".nnidx";
+    return path.size() >= ext.size() &&
+           path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "common_defs.h"
+#include "mapped_file.h"
+#include "note_sequence.h"
+
+// Precomputed, memory-mapped form of a reference piece: its note columns,
+// its pitch-interval array and a suffix array over those intervals. Loading
+// an index skips SMF parsing and index construction entirely, and matching
+// reads every section in place, so repeated queries against a known
+// reference start immediately and share one copy of it.
+//
+// File layout (native byte order, every section 8-byte aligned):
+//   header | pitch[note_count] (int8) | onset | duration | tempo (double)
+//   | channel[note_count] (uint8) | intervals[interval_count] (int32)
+//   | suffix_array[interval_count] (int32)
+class ReferenceIndex {
+public:
+    // Builds the acceleration structures for `notes` and writes them to `path`.
+    static void write(const std::string& path, const std::vector<NoteEvent>& notes);
+    static ReferenceIndex open(const std::string& path);
+
+    static bool is_index_path(const std::string& path);
+
+    size_t note_count() const { return columns().size(); }
+    // Points into the mapping; valid while the index is open.
+    NoteColumns columns() const { return note_columns; }
+
+    size_t interval_count() const { return interval_total; }
+    const int32_t* intervals() const { return interval_data; }
+    // Suffix array over intervals(), sorted lexicographically.
+    const int32_t* suffix_array() const { return suffix_data; }
+
+private:
+    MappedFile file;
+    NoteColumns note_columns;
+    size_t interval_total = 0;
+    const int32_t* interval_data = nullptr;
+    const int32_t* suffix_data = nullptr;
+};
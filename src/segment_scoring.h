@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+// Scoring rule shared by every matcher that produces MatchSegments: a fixed
+// number of points per matched note plus a bonus for each note whose
+// duration agrees within a tolerance, capped at 100.
+//
+// A grading profile is a struct of compile-time constants. The calculator is
+// instantiated once per profile, so each one gets kernels with its constants
+// folded in and no runtime branching on the profile.
+namespace SegmentScoring {
+    // The original grading: 5 points per note, 2 per duration within 15%.
+    struct Standard {
+        static constexpr int min_exact_run = 4;
+        static constexpr double base_score_per_note = 5.0;
+        static constexpr double rhythm_match_bonus = 2.0;
+        static constexpr double rhythm_tolerance = 0.15;
+        // The fallback search runs when no exact candidate reaches this.
+        static constexpr double fallback_trigger = 90.0;
+    };
+
+    // Rhythm weighs more and must be tighter; for graded timing exercises.
+    struct StrictRhythm {
+        static constexpr int min_exact_run = 4;
+        static constexpr double base_score_per_note = 4.0;
+        static constexpr double rhythm_match_bonus = 3.0;
+        static constexpr double rhythm_tolerance = 0.08;
+        static constexpr double fallback_trigger = 95.0;
+    };
+
+    // Shorter runs count and durations may drift; for sight-reading takes.
+    struct Lenient {
+        static constexpr int min_exact_run = 3;
+        static constexpr double base_score_per_note = 5.0;
+        static constexpr double rhythm_match_bonus = 2.0;
+        static constexpr double rhythm_tolerance = 0.25;
+        static constexpr double fallback_trigger = 80.0;
+    };
+
+    enum class Profile {
+        Standard,
+        StrictRhythm,
+        Lenient
+    };
+
+    inline Profile profile_from_name(const std::string& name) {
+        if (name == "standard") return Profile::Standard;
+        if (name == "strict") return Profile::StrictRhythm;
+        if (name == "lenient") return Profile::Lenient;
+        throw std::runtime_error("Unknown scoring profile: " + name);
+    }
+
+    template <typename Policy = Standard>
+    inline bool durations_match(double ref_value, double perf_value) {
+        return std::abs(ref_value - perf_value) <= ref_value * Policy::rhythm_tolerance;
+    }
+
+    template <typename Policy = Standard>
+    inline double segment_score(size_t note_count, int rhythm_matches) {
+        double length_score = Policy::base_score_per_note * note_count;
+        double rhythm_score = Policy::rhythm_match_bonus * rhythm_matches;
+        return std::min(length_score + rhythm_score, 100.0);
+    }
+}
@@ -1,34 +1,152 @@
 #include "similarity_calculator.h"
+#include "bit_parallel_matcher.h"
+#include "interval_kernels.h"
+#include "metrics.h"
+#include "ngram_seeds.h"
+#include "reference_index.h"
+#include "segment_scoring.h"
+#include "thread_pool.h"
+#include "suffix_array.h"
+#include "trace.h"
 #include <cmath>
 #include <algorithm>
 #include <limits>
+#include <map>
+#include <mutex>
 #include <numeric>
 #include <unordered_map>
-#include <iostream>
 
-SimilarityCalculator::SimilarityCalculator(
-    const std::vector<NoteEvent>& ref,
-    const std::vector<NoteEvent>& perf
-) : ref_notes(ref), perf_notes(perf) {}
+namespace {
+    // Length of note i in quarter-note units, or in seconds scaled the same
+    // way when comparing in absolute time.
+    template <typename Notes>
+    double note_duration(const Notes& notes, size_t i, bool use_musical_time) {
+        if (use_musical_time) {
+            return notes.duration[i];
+        }
+        return notes.duration[i] * (60.0 / notes.tempo[i]) * 4;
+    }
+
+    // Order of the top-K heap: higher similarity first, then longer, then by
+    // position so equal scores are kept deterministically.
+    bool ranks_above(const MatchSegment& a, const MatchSegment& b) {
+        if (a.similarity != b.similarity) return a.similarity > b.similarity;
+        if (a.length != b.length) return a.length > b.length;
+        if (a.ref_start != b.ref_start) return a.ref_start < b.ref_start;
+        return a.perf_start < b.perf_start;
+    }
+
+    // Pairs (text index, pattern index) of equal values along one optimal
+    // global edit alignment of pattern[0 .. m) against text[0 .. n), in
+    // order. Substitutions, insertions and deletions contribute no pair; on
+    // ties the traceback prefers the diagonal.
+    std::vector<std::pair<int, int>> aligned_matches(const int* text, int n, const int* pattern, int m) {
+        std::vector<int> cost(static_cast<size_t>(n + 1) * (m + 1));
+        auto at = [&](int i, int j) -> int& { return cost[static_cast<size_t>(i) * (m + 1) + j]; };
+        for (int i = 0; i <= n; ++i) at(i, 0) = i;
+        for (int j = 0; j <= m; ++j) at(0, j) = j;
+        for (int i = 1; i <= n; ++i) {
+            for (int j = 1; j <= m; ++j) {
+                at(i, j) = std::min({at(i - 1, j - 1) + (text[i - 1] != pattern[j - 1]),
+                                     at(i - 1, j) + 1,
+                                     at(i, j - 1) + 1});
+            }
+        }
+
+        std::vector<std::pair<int, int>> pairs;
+        int i = n;
+        int j = m;
+        while (i > 0 && j > 0) {
+            const bool equal = text[i - 1] == pattern[j - 1];
+            if (at(i, j) == at(i - 1, j - 1) + !equal) {
+                if (equal) pairs.emplace_back(i - 1, j - 1);
+                --i;
+                --j;
+            } else if (at(i, j) == at(i - 1, j) + 1) {
+                --i;
+            } else {
+                --j;
+            }
+        }
+        std::reverse(pairs.begin(), pairs.end());
+        return pairs;
+    }
 
+    // Disjoint half-open spans of claimed note indices on one axis.
+    class OccupiedSpans {
+    public:
+        explicit OccupiedSpans(size_t limit) : limit(static_cast<int>(limit)) {}
+
+        bool is_free(int start, int end) const {
+            if (start < 0 || end > limit) return false;
+            auto it = spans.lower_bound(end);
+            if (it == spans.begin()) return true;
+            --it;
+            return it->second <= start;
+        }
+
+        void claim(int start, int end) {
+            spans.emplace(start, end);
+        }
 
-bool SimilarityCalculator::was_fallback_used() const {
+    private:
+        int limit;
+        std::map<int, int> spans;
+    };
+}
+
+template <typename Scoring>
+BasicSimilarityCalculator<Scoring>::BasicSimilarityCalculator(
+    const NoteSequence& ref,
+    const NoteSequence& perf,
+    CandidateMode mode,
+    MatchEngine engine,
+    FallbackStrategy fallback,
+    int max_edits
+) : ref_sequence(&ref),
+    perf_notes(perf),
+    candidate_mode(mode),
+    match_engine(engine),
+    fallback_strategy(fallback),
+    max_edits(max_edits) {}
+
+template <typename Scoring>
+BasicSimilarityCalculator<Scoring>::BasicSimilarityCalculator(
+    const ReferenceIndex& ref,
+    const NoteSequence& perf,
+    CandidateMode mode,
+    MatchEngine engine,
+    FallbackStrategy fallback,
+    int max_edits
+) : ref_index(&ref),
+    perf_notes(perf),
+    candidate_mode(mode),
+    match_engine(engine),
+    fallback_strategy(fallback),
+    max_edits(max_edits) {}
+
+
+template <typename Scoring>
+bool BasicSimilarityCalculator<Scoring>::was_fallback_used() const {
     return fallback_used;
 }
 
-void SimilarityCalculator::compute_intervals() {
-    ref_intervals.clear();
-    for (size_t i = 1; i < ref_notes.size(); ++i) {
-        ref_intervals.push_back(ref_notes[i].pitch - ref_notes[i-1].pitch);
-    }
-    perf_intervals.clear();
-    for (size_t i = 1; i < perf_notes.size(); ++i) {
-        perf_intervals.push_back(perf_notes[i].pitch - perf_notes[i-1].pitch);
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::compute_intervals() {
+    if (ref_index) {
+        ref_notes = ref_index->columns();
+        ref_intervals = {ref_index->intervals(), ref_index->interval_count()};
+    } else {
+        ref_notes = ref_sequence->columns();
+        ref_interval_storage = ref_sequence->intervals();
+        ref_intervals = {ref_interval_storage.data(), ref_interval_storage.size()};
     }
+    perf_intervals = perf_notes.intervals();
 }
 
 
-void SimilarityCalculator::perform_fallback_check(
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::perform_fallback_check(
     std::vector<MatchSegment>& candidates,
     double threshold,
     bool use_musical_time 
@@ -38,60 +156,71 @@ void SimilarityCalculator::perform_fallback_check(
         return;
     }
 
-    constexpr double rhythm_tolerance = 0.15;
     constexpr double absolute_epsilon = 0.01;
 
+    // Durations are non-negative, so the time covered by perf[perf_idx ..
+    // search_idx) only grows with search_idx. Prefix sums give it in O(1) and
+    // let the first note inside the tolerance window be found by bisection.
+    std::vector<double> ref_durations(ref_notes.size());
+    for (size_t k = 0; k < ref_notes.size(); ++k) {
+        ref_durations[k] = note_duration(ref_notes, k, use_musical_time);
+    }
+    std::vector<double> perf_elapsed(perf_notes.size() + 1, 0.0);
+    for (size_t k = 0; k < perf_notes.size(); ++k) {
+        perf_elapsed[k + 1] = perf_elapsed[k] + note_duration(perf_notes, k, use_musical_time);
+    }
+
+    [[maybe_unused]] uint64_t probes = 0;
     for (size_t perf_start = 0; perf_start + 1 < perf_notes.size(); ++perf_start) {
         size_t ref_idx = 0;
         size_t perf_idx = perf_start;
         int matched_pairs = 0;
 
         while (ref_idx + 1 < ref_notes.size() && perf_idx + 1 < perf_notes.size()) {
-            int ref_interval = ref_notes[ref_idx + 1].pitch - ref_notes[ref_idx].pitch;
-            
-            double ref_duration;
-            if (use_musical_time) {
-                ref_duration = ref_notes[ref_idx].note_value; 
-            } else {
-
-                ref_duration = ref_notes[ref_idx].note_value * (60.0 / ref_notes[ref_idx].bpm) * 4;
+            int ref_interval = ref_notes.pitch[ref_idx + 1] - ref_notes.pitch[ref_idx];
+            double ref_duration = ref_durations[ref_idx];
+            double min_duration = (1.0 - rhythm_tolerance) * ref_duration;
+            double max_duration = (1.0 + rhythm_tolerance) * ref_duration;
+
+            auto accumulated = [&](size_t search_idx) {
+                return perf_elapsed[search_idx] - perf_elapsed[perf_idx];
+            };
+
+            size_t lo = perf_idx + 1;
+            size_t hi = perf_notes.size();
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (accumulated(mid) + absolute_epsilon < min_duration) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
             }
 
             bool interval_matched = false;
 
-            for (size_t search_idx = perf_idx + 1; search_idx < perf_notes.size(); ++search_idx) {
-                int perf_interval = perf_notes[search_idx].pitch - perf_notes[perf_idx].pitch;
+            for (size_t search_idx = lo; search_idx < perf_notes.size(); ++search_idx) {
+                int perf_interval = perf_notes.pitch[search_idx] - perf_notes.pitch[perf_idx];
+                double accumulated_duration = accumulated(search_idx);
+                ++probes;
 
-                double accumulated_duration = 0.0;
-                if (use_musical_time) {
-                    for (size_t k = perf_idx; k < search_idx; ++k) {
-                        accumulated_duration += perf_notes[k].note_value;
-                    }
-                } else {
-                    for (size_t k = perf_idx; k < search_idx; ++k) {
-                        accumulated_duration += perf_notes[k].note_value * (60.0 / perf_notes[k].bpm) * 4;
-                    }
-                }
+                NNOTE_TRACE(TraceCategory::Fallback, TraceLevel::Debug,
+                    "[Fallback " << (use_musical_time ? "Musical" : "Absolute")
+                    << "] Trying ref[" << ref_idx << "] (interval=" << ref_interval
+                    << ", dur=" << ref_duration << ") with perf[" << perf_idx
+                    << "->" << search_idx << "] (acc_dur=" << accumulated_duration << ")");
 
-                std::cout << "[Fallback " << (use_musical_time ? "Musical" : "Absolute") 
-                          << "] Trying ref[" << ref_idx << "] (interval=" << ref_interval 
-                          << ", dur=" << ref_duration << ") with perf[" << perf_idx 
-                          << "->" << search_idx << "] (acc_dur=" << accumulated_duration << ")\n";
+                if (accumulated_duration > max_duration + absolute_epsilon) {
+                    break;
+                }
 
-                if (perf_interval == ref_interval &&
-                    accumulated_duration + absolute_epsilon >= (1.0 - rhythm_tolerance) * ref_duration &&
-                    accumulated_duration - absolute_epsilon <= (1.0 + rhythm_tolerance) * ref_duration) 
-                {
+                if (perf_interval == ref_interval) {
                     perf_idx = search_idx;
                     ++ref_idx;
                     ++matched_pairs;
                     interval_matched = true;
                     break;
                 }
-
-                if (accumulated_duration > (1.0 + rhythm_tolerance) * ref_duration + absolute_epsilon) {
-                    break;
-                }
             }
 
             if (!interval_matched) {
@@ -99,10 +228,10 @@ void SimilarityCalculator::perform_fallback_check(
             }
         }
 
-        if (matched_pairs >= 3) {
+        double similarity = std::min(matched_pairs * 33.3, 100.0);
+        if (matched_pairs >= 3 && similarity >= threshold) {
             int matched_length = static_cast<int>(perf_idx - perf_start + 1);
-            double similarity = std::min(matched_pairs * 33.3, 100.0);
-            candidates.push_back({
+            add_candidate(candidates, {
                 0,
                 static_cast<int>(perf_start),
                 matched_length,
@@ -111,102 +240,553 @@ void SimilarityCalculator::perform_fallback_check(
             });
         }
     }
+    NNOTE_COUNT(MetricCounter::FallbackProbes, probes);
 }
 
 
-std::vector<MatchSegment> SimilarityCalculator::find_similar_segments(double similarity_threshold) {
-    fallback_used = false;
-    compute_intervals();
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::perform_approximate_check(
+    std::vector<MatchSegment>& candidates,
+    double threshold
+) {
+    fallback_used = true;
     const int n = ref_intervals.size();
     const int m = perf_intervals.size();
-    std::vector<MatchSegment> candidates;
+    if (n == 0 || m == 0) {
+        return;
+    }
 
-    if (n > 0 && m > 0) {
-        std::vector<std::vector<int>> dp(n, std::vector<int>(m, 0));
-        for (int i = 0; i < n; ++i) {
-            for (int j = 0; j < m; ++j) {
-                if (ref_intervals[i] == perf_intervals[j]) {
-                    dp[i][j] = (i > 0 && j > 0) ? dp[i-1][j-1] + 1 : 1;
-                    if (dp[i][j] >= 4) {
-                        int length = dp[i][j] + 1;
-                        int ref_start = i - dp[i][j] + 1;
-                        int perf_start = j - dp[i][j] + 1;
-                        if (ref_start >=0 && perf_start >=0 &&
-                            ref_start + length <= static_cast<int>(ref_notes.size()) &&
-                            perf_start + length <= static_cast<int>(perf_notes.size())) 
-                        {
-                            std::vector<NoteEvent> ref_seg(
-                                ref_notes.begin() + ref_start,
-                                ref_notes.begin() + ref_start + length
-                            );
-                            std::vector<NoteEvent> perf_seg(
-                                perf_notes.begin() + perf_start,
-                                perf_notes.begin() + perf_start + length
-                            );
-                            double sim = calculate_segment_similarity(ref_seg, perf_seg);
-                            if (sim >= similarity_threshold) {
-                                candidates.push_back({
-                                    static_cast<int>(ref_start), 
-                                    static_cast<int>(perf_start), 
-                                    static_cast<int>(length), 
-                                    sim,
-                                    0.0
-                                });
-                            }
+    // A window at every performance start, grown as far as some reference
+    // substring still lies within max_edits of it (at most 64 intervals).
+    // The best distance only rises as a window grows, so the longest window
+    // from one start never ends before the previous start's; each start
+    // costs about two bit-parallel scans. Unrelated notes around a near
+    // match therefore only shorten the windows that include them.
+    const int max_window = BitParallelMatcher::max_pattern_length;
+    auto window_distances = [&](int perf_start, int perf_end, std::vector<int>& out) {
+        NNOTE_COUNT(MetricCounter::FallbackProbes, 1);
+        BitParallelMatcher matcher(perf_intervals.data() + perf_start, perf_end - perf_start);
+        out = matcher.search(ref_intervals.data(), n);
+        return *std::min_element(out.begin(), out.end()) <= max_edits;
+    };
+
+    std::vector<int> distances;
+    std::vector<int> grown;
+    int window_end = 0;
+    for (int perf_start = 0; perf_start + min_exact_run <= m; ++perf_start) {
+        const int limit = std::min(m, perf_start + max_window);
+        int end = std::max(window_end, perf_start + min_exact_run);
+        if (!window_distances(perf_start, end, distances)) {
+            continue;
+        }
+        while (end < limit && window_distances(perf_start, end + 1, grown)) {
+            distances.swap(grown);
+            ++end;
+        }
+        window_end = end;
+
+        // Every reference end within max_edits is an occurrence candidate;
+        // overlap resolution keeps the longest. Neighbouring ends often trim
+        // to the same segment, which is added once.
+        const int window = end - perf_start;
+        BitParallelMatcher matcher(perf_intervals.data() + perf_start, window);
+        MatchSegment previous{-1, -1, 0, 0.0, 0.0};
+        for (int ref_end = 0; ref_end < n; ++ref_end) {
+            if (distances[ref_end] > max_edits) {
+                continue;
+            }
+            int distance = 0;
+            const int ref_start = matcher.best_start(ref_intervals.data(), ref_end, max_edits, distance);
+
+            // Score along the edit alignment: leading and trailing edits are
+            // trimmed off, and only notes joined by matching intervals are
+            // paired for length points and rhythm.
+            const auto pairs = aligned_matches(ref_intervals.data() + ref_start, ref_end - ref_start + 1,
+                                               perf_intervals.data() + perf_start, window);
+            if (pairs.empty()) {
+                continue;
+            }
+            const int seg_ref = ref_start + pairs.front().first;
+            const int seg_perf = perf_start + pairs.front().second;
+            // Indels make the two spans differ; the shorter one is reported so
+            // the segment claims no note outside the match on either axis.
+            const int length = std::min(pairs.back().first - pairs.front().first,
+                                        pairs.back().second - pairs.front().second) + 2;
+
+            int matched_notes = 1;
+            int rhythm_matches = durations_match(ref_notes.duration[seg_ref], perf_notes.duration[seg_perf]) ? 1 : 0;
+            for (const auto& pair : pairs) {
+                const int r = ref_start + pair.first + 1;
+                const int p = perf_start + pair.second + 1;
+                ++matched_notes;
+                if (durations_match(ref_notes.duration[r], perf_notes.duration[p])) {
+                    ++rhythm_matches;
+                }
+            }
+            double sim = segment_score(matched_notes, rhythm_matches);
+            const bool repeated = seg_ref == previous.ref_start && seg_perf == previous.perf_start &&
+                                  length == previous.length && sim == previous.similarity;
+            if (sim >= threshold && !repeated) {
+                previous = {seg_ref, seg_perf, length, sim, 0.0};
+                add_candidate(candidates, previous);
+            }
+        }
+    }
+}
+
+
+template <typename Scoring>
+double BasicSimilarityCalculator<Scoring>::try_exact_candidate(
+    std::vector<MatchSegment>& candidates,
+    int i,
+    int j,
+    int run,
+    double similarity_threshold
+) {
+    int length = run + 1;
+    int ref_start = i - run + 1;
+    int perf_start = j - run + 1;
+    if (ref_start >= 0 && perf_start >= 0 &&
+        ref_start + length <= static_cast<int>(ref_notes.size()) &&
+        perf_start + length <= static_cast<int>(perf_notes.size()))
+    {
+        // Every note can at best add its rhythm bonus too; if even that
+        // cannot enter a full top-K heap, the run is not scored at all.
+        if (!may_enter_top_k(candidates, {ref_start, perf_start, length, segment_score(length, length), 0.0})) {
+            return -1.0;
+        }
+        double sim = calculate_segment_similarity(ref_start, perf_start, length);
+        if (sim >= similarity_threshold) {
+            add_candidate(candidates, {
+                ref_start,
+                perf_start,
+                length,
+                sim,
+                0.0
+            });
+        }
+        return sim;
+    }
+    return -1.0;
+}
+
+
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::try_best_window(
+    std::vector<MatchSegment>& candidates,
+    int ref_start,
+    int perf_start,
+    int length,
+    double run_score
+) {
+    // The score only grows with length, so the best proper sub-window of a
+    // run is its shortest prefix that already reaches the run's capped score.
+    // Anything shorter than the whole run leaves its tail free for other
+    // segments during overlap resolution.
+    int rhythm_matches = 0;
+    for (int k = 0; k + 1 < length; ++k) {
+        if (durations_match(ref_notes.duration[ref_start + k], perf_notes.duration[perf_start + k])) {
+            ++rhythm_matches;
+        }
+        int window = k + 1;
+        if (window > min_exact_run && segment_score(window, rhythm_matches) >= run_score) {
+            add_candidate(candidates, {ref_start, perf_start, window, run_score, 0.0});
+            return;
+        }
+    }
+}
+
+
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::emit_run(
+    std::vector<MatchSegment>& candidates,
+    int i,
+    int j,
+    int run,
+    double similarity_threshold
+) {
+    if (candidate_mode == CandidateMode::AllPrefixes) {
+        try_exact_candidate(candidates, i, j, run, similarity_threshold);
+        return;
+    }
+
+    // A run is maximal once the next diagonal cell breaks it; its prefixes
+    // were already seen on the way here and are not emitted separately.
+    const int n = ref_intervals.size();
+    const int m = perf_intervals.size();
+    if (i + 1 < n && j + 1 < m && ref_intervals[i + 1] == perf_intervals[j + 1]) {
+        return;
+    }
+    emit_maximal_run(candidates, i, j, run, similarity_threshold);
+}
+
+
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::emit_maximal_run(
+    std::vector<MatchSegment>& candidates,
+    int i,
+    int j,
+    int run,
+    double similarity_threshold
+) {
+    if (candidate_mode == CandidateMode::AllPrefixes) {
+        for (int k = min_exact_run; k <= run; ++k) {
+            try_exact_candidate(candidates, i - run + k, j - run + k, k, similarity_threshold);
+        }
+        return;
+    }
+
+    double sim = try_exact_candidate(candidates, i, j, run, similarity_threshold);
+    if (candidate_mode == CandidateMode::MaximalRunsWithBestWindow && sim >= similarity_threshold) {
+        try_best_window(candidates, i - run + 1, j - run + 1, run + 1, sim);
+    }
+}
+
+
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::collect_diagonal_candidates(
+    std::vector<MatchSegment>& candidates,
+    const std::vector<int8_t>& ref_packed,
+    const std::vector<int8_t>& perf_packed,
+    double similarity_threshold
+) {
+    const int n = ref_intervals.size();
+    const int m = perf_intervals.size();
+    const auto equality_mask = IntervalKernels::equality_mask();
+    const bool every_prefix = candidate_mode == CandidateMode::AllPrefixes;
+
+    // Runs of equal intervals are streaks of set bits along each diagonal
+    // j - i = d. Every 32 cells come from one vector compare, and chunks with
+    // no match and no open run are skipped without touching single cells.
+    for (int d = -(n - 1); d < m; ++d) {
+        const int i0 = std::max(0, -d);
+        const int j0 = i0 + d;
+        const int cells = std::min(n - i0, m - j0);
+        int run = 0;
+
+        auto close_run = [&](int end_offset) {
+            if (!every_prefix && run >= min_exact_run) {
+                emit_maximal_run(candidates, i0 + end_offset, j0 + end_offset, run, similarity_threshold);
+            }
+            run = 0;
+        };
+
+        for (int base = 0; base < cells; base += IntervalKernels::lanes) {
+            const int width = std::min(IntervalKernels::lanes, cells - base);
+            uint32_t mask = equality_mask(ref_packed.data() + i0 + base, perf_packed.data() + j0 + base);
+            if (width < IntervalKernels::lanes) {
+                mask &= (uint32_t(1) << width) - 1;
+            }
+            if (mask == 0 && run == 0) {
+                continue;
+            }
+
+            // Step over whole streaks: skip to the next set bit when no run
+            // is open, then consume the following block of set bits at once.
+            int k = 0;
+            while (k < width) {
+                uint32_t rest = mask >> k;
+                if (run == 0) {
+                    if (rest == 0) break;
+                    k += IntervalKernels::trailing_zeros(rest);
+                    rest = mask >> k;
+                }
+                int ones = std::min(IntervalKernels::trailing_zeros(~rest), width - k);
+                if (ones == 0) {
+                    close_run(base + k - 1);
+                    ++k;
+                    continue;
+                }
+                if (every_prefix) {
+                    for (int t = 0; t < ones; ++t) {
+                        if (++run >= min_exact_run) {
+                            try_exact_candidate(candidates, i0 + base + k + t, j0 + base + k + t,
+                                                run, similarity_threshold);
                         }
                     }
+                } else {
+                    run += ones;
                 }
+                k += ones;
             }
         }
+        if (run > 0) {
+            close_run(cells - 1);
+        }
     }
+}
 
-    bool has_high_similarity = false;
-    for (const auto& seg : candidates) {
-        if (seg.similarity >= 90.0) { 
-            has_high_similarity = true;
-            break;
+
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::collect_wavefront_candidates(
+    std::vector<MatchSegment>& candidates,
+    double similarity_threshold
+) {
+    constexpr int tile = 1024;
+    const int n = ref_intervals.size();
+    const int m = perf_intervals.size();
+    const int tile_rows = (n + tile - 1) / tile;
+    const int tile_cols = (m + tile - 1) / tile;
+
+    // Tile (I, J) needs the last row of (I - 1, J), the last column of
+    // (I, J - 1) and the corner of (I - 1, J - 1): one and two waves back.
+    // Edges are kept for three anti-diagonal waves, indexed by tile row.
+    std::vector<std::vector<int>> bottom_edges[3];
+    std::vector<std::vector<int>> right_edges[3];
+    for (int w = 0; w < 3; ++w) {
+        bottom_edges[w].assign(tile_rows, std::vector<int>(tile, 0));
+        right_edges[w].assign(tile_rows, std::vector<int>(tile, 0));
+    }
+
+    std::mutex candidates_mutex;
+    ThreadPool pool;
+
+    for (int wave = 0; wave < tile_rows + tile_cols - 1; ++wave) {
+        const int first_row = std::max(0, wave - tile_cols + 1);
+        const int last_row = std::min(tile_rows - 1, wave);
+        for (int I = first_row; I <= last_row; ++I) {
+            pool.submit([&, wave, I] {
+                const int J = wave - I;
+                const int i0 = I * tile;
+                const int j0 = J * tile;
+                const int i1 = std::min(n, i0 + tile);
+                const int width = std::min(m, j0 + tile) - j0;
+
+                const std::vector<int>* top = I > 0 ? &bottom_edges[(wave + 2) % 3][I - 1] : nullptr;
+                const std::vector<int>* left = J > 0 ? &right_edges[(wave + 2) % 3][I] : nullptr;
+                const int corner = (I > 0 && J > 0) ? bottom_edges[(wave + 1) % 3][I - 1][tile - 1] : 0;
+
+                // prev[c] / cur[c] hold run lengths at column j0 + c - 1;
+                // slot 0 is the column just left of the tile.
+                std::vector<int> prev(width + 1, 0);
+                std::vector<int> cur(width + 1, 0);
+                prev[0] = corner;
+                if (top) {
+                    std::copy(top->begin(), top->begin() + width, prev.begin() + 1);
+                }
+
+                std::vector<MatchSegment> local;
+                std::vector<int>& right_out = right_edges[wave % 3][I];
+                for (int i = i0; i < i1; ++i) {
+                    cur[0] = left ? (*left)[i - i0] : 0;
+                    const int ref_value = ref_intervals[i];
+                    for (int c = 1; c <= width; ++c) {
+                        const int j = j0 + c - 1;
+                        cur[c] = (ref_value == perf_intervals[j]) ? prev[c - 1] + 1 : 0;
+                        if (cur[c] >= min_exact_run) {
+                            emit_run(local, i, j, cur[c], similarity_threshold);
+                        }
+                    }
+                    right_out[i - i0] = cur[width];
+                    prev.swap(cur);
+                }
+                std::copy(prev.begin() + 1, prev.end(), bottom_edges[wave % 3][I].begin());
+
+                std::lock_guard<std::mutex> lock(candidates_mutex);
+                for (const auto& seg : local) {
+                    add_candidate(candidates, seg);
+                }
+            });
         }
+        pool.wait();
     }
+}
 
-    if (!has_high_similarity) {
-        perform_fallback_check(candidates, similarity_threshold, true); 
 
-        if (candidates.empty()) {
-            perform_fallback_check(candidates, similarity_threshold, false);
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::collect_exact_candidates(
+    std::vector<MatchSegment>& candidates,
+    double similarity_threshold
+) {
+    const int n = ref_intervals.size();
+    const int m = perf_intervals.size();
+
+    if (match_engine == MatchEngine::SuffixArray) {
+        // A prebuilt reference index already holds the reference's suffix
+        // array, so only the performance has to be scanned.
+        std::vector<ExactRun> runs = ref_index
+            ? SuffixArray::maximal_common_runs(ref_index->intervals(), n, ref_index->suffix_array(),
+                                               perf_intervals, min_exact_run)
+            : SuffixArray::maximal_common_runs(ref_interval_storage, perf_intervals, min_exact_run);
+        for (const auto& r : runs) {
+            emit_maximal_run(candidates, r.a_start + r.length - 1, r.b_start + r.length - 1,
+                             r.length, similarity_threshold);
         }
+        return;
     }
 
-    std::sort(candidates.begin(), candidates.end(), [](const MatchSegment& a, const MatchSegment& b) {
-        if (a.length != b.length) return a.length > b.length;
-        return a.similarity > b.similarity;
-    });
+    if (match_engine == MatchEngine::SeedAndExtend) {
+        for (const auto& r : NgramSeeds::maximal_common_runs(ref_intervals.data(), n, perf_intervals, min_exact_run)) {
+            emit_maximal_run(candidates, r.a_start + r.length - 1, r.b_start + r.length - 1,
+                             r.length, similarity_threshold);
+        }
+        return;
+    }
 
-    std::vector<bool> ref_used(ref_notes.size(), false);
-    std::vector<bool> perf_used(perf_notes.size(), false);
+    // The remaining engines visit every cell of the table.
+    NNOTE_COUNT(MetricCounter::DpCells, static_cast<uint64_t>(n) * m);
+
+    if (match_engine == MatchEngine::WavefrontDP) {
+        collect_wavefront_candidates(candidates, similarity_threshold);
+        return;
+    }
+
+    std::vector<int8_t> ref_packed;
+    std::vector<int8_t> perf_packed;
+    IntervalKernels::pack(ref_intervals.data(), n, ref_packed);
+    IntervalKernels::pack(perf_intervals.data(), m, perf_packed);
+    collect_diagonal_candidates(candidates, ref_packed, perf_packed, similarity_threshold);
+}
+
+
+template <typename Scoring>
+std::vector<MatchSegment> BasicSimilarityCalculator<Scoring>::select_non_overlapping(
+    const std::vector<MatchSegment>& candidates,
+    const SegmentCallback& on_selected
+) const {
+    // Occupied notes on each axis are kept as disjoint [start, end) spans, so
+    // testing and claiming a candidate costs O(log k) instead of a walk over
+    // its notes.
+    OccupiedSpans ref_used(ref_notes.size());
+    OccupiedSpans perf_used(perf_notes.size());
     std::vector<MatchSegment> results;
 
     for (const auto& seg : candidates) {
-        bool overlap = false;
-        for (size_t k = 0; k < seg.length; ++k) {
-            size_t r = seg.ref_start + k;
-            size_t p = seg.perf_start + k;
-            if (r >= ref_used.size() || p >= perf_used.size() || ref_used[r] || perf_used[p]) {
-                overlap = true;
-                break;
-            }
-        }
-        if (!overlap) {
+        if (seg.length <= 0) {
             results.push_back(seg);
-            for (size_t k = 0; k < seg.length; ++k) {
-                size_t r = seg.ref_start + k;
-                size_t p = seg.perf_start + k;
-                if (r < ref_used.size()) ref_used[r] = true;
-                if (p < perf_used.size()) perf_used[p] = true;
+            if (on_selected) on_selected(seg);
+            continue;
+        }
+        const int ref_end = seg.ref_start + seg.length;
+        const int perf_end = seg.perf_start + seg.length;
+        if (!ref_used.is_free(seg.ref_start, ref_end) || !perf_used.is_free(seg.perf_start, perf_end)) {
+            continue;
+        }
+        ref_used.claim(seg.ref_start, ref_end);
+        perf_used.claim(seg.perf_start, perf_end);
+        results.push_back(seg);
+        if (on_selected) on_selected(seg);
+    }
+    return results;
+}
+
+
+template <typename Scoring>
+std::vector<MatchSegment> BasicSimilarityCalculator<Scoring>::find_similar_segments(double similarity_threshold) {
+    return find_similar_segments(similarity_threshold, nullptr);
+}
+
+
+template <typename Scoring>
+std::vector<MatchSegment> BasicSimilarityCalculator<Scoring>::find_top_segments(size_t k, double similarity_threshold) {
+    if (k == 0) {
+        return {};
+    }
+    top_k = k;
+    std::vector<MatchSegment> results = find_similar_segments(similarity_threshold, nullptr);
+    top_k = 0;
+    return results;
+}
+
+
+template <typename Scoring>
+bool BasicSimilarityCalculator<Scoring>::may_enter_top_k(const std::vector<MatchSegment>& candidates,
+                                           const MatchSegment& seg) const {
+    return top_k == 0 || candidates.size() < top_k || ranks_above(seg, candidates.front());
+}
+
+
+template <typename Scoring>
+void BasicSimilarityCalculator<Scoring>::add_candidate(std::vector<MatchSegment>& candidates, const MatchSegment& seg) const {
+    if (top_k == 0) {
+        candidates.push_back(seg);
+        return;
+    }
+    // Bounded heap with the weakest kept candidate at the front. Kept
+    // candidates never share notes, so k applies to the non-overlapping
+    // result: a candidate that overlaps kept ones replaces them only if it
+    // ranks above all of them, and a rejected one takes no slot.
+    auto overlaps = [](const MatchSegment& a, const MatchSegment& b) {
+        if (a.length <= 0 || b.length <= 0) return false;
+        return (a.ref_start < b.ref_start + b.length && b.ref_start < a.ref_start + a.length) ||
+               (a.perf_start < b.perf_start + b.length && b.perf_start < a.perf_start + a.length);
+    };
+    bool displaced = false;
+    for (const auto& kept : candidates) {
+        if (overlaps(seg, kept)) {
+            if (!ranks_above(seg, kept)) return;
+            displaced = true;
+        }
+    }
+    if (displaced) {
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [&](const MatchSegment& kept) { return overlaps(seg, kept); }),
+                         candidates.end());
+        std::make_heap(candidates.begin(), candidates.end(), ranks_above);
+    }
+    if (candidates.size() < top_k) {
+        candidates.push_back(seg);
+        std::push_heap(candidates.begin(), candidates.end(), ranks_above);
+    } else if (ranks_above(seg, candidates.front())) {
+        std::pop_heap(candidates.begin(), candidates.end(), ranks_above);
+        candidates.back() = seg;
+        std::push_heap(candidates.begin(), candidates.end(), ranks_above);
+    }
+}
+
+
+template <typename Scoring>
+std::vector<MatchSegment> BasicSimilarityCalculator<Scoring>::find_similar_segments(
+    double similarity_threshold,
+    const SegmentCallback& on_selected
+) {
+    fallback_used = false;
+    compute_intervals();
+    const int n = ref_intervals.size();
+    const int m = perf_intervals.size();
+    std::vector<MatchSegment> candidates;
+
+    if (n > 0 && m > 0) {
+        NNOTE_TIME_STAGE(MetricStage::IntervalDP);
+        collect_exact_candidates(candidates, similarity_threshold);
+    }
+
+    bool has_high_similarity = false;
+    for (const auto& seg : candidates) {
+        if (seg.similarity >= Scoring::fallback_trigger) { 
+            has_high_similarity = true;
+            break;
+        }
+    }
+
+    if (!has_high_similarity) {
+        NNOTE_TIME_STAGE(MetricStage::FallbackSearch);
+        if (fallback_strategy == FallbackStrategy::ApproximateIntervals) {
+            perform_approximate_check(candidates, similarity_threshold);
+        } else {
+            perform_fallback_check(candidates, similarity_threshold, true); 
+
+            if (candidates.empty()) {
+                perform_fallback_check(candidates, similarity_threshold, false);
             }
         }
     }
 
-    std::sort(results.begin(), results.end(), [](const MatchSegment& a, const MatchSegment& b) {
+    NNOTE_COUNT(MetricCounter::Candidates, candidates.size());
+    NNOTE_TIME_STAGE(MetricStage::OverlapResolution);
+
+    // Ties are broken on position so the selection below does not depend on
+    // the order in which the DP happened to emit candidates.
+    std::sort(candidates.begin(), candidates.end(), [](const MatchSegment& a, const MatchSegment& b) {
+        if (a.length != b.length) return a.length > b.length;
+        if (a.similarity != b.similarity) return a.similarity > b.similarity;
+        if (a.ref_start != b.ref_start) return a.ref_start < b.ref_start;
+        return a.perf_start < b.perf_start;
+    });
+
+    std::vector<MatchSegment> results = select_non_overlapping(candidates, on_selected);
+
+    std::stable_sort(results.begin(), results.end(), [](const MatchSegment& a, const MatchSegment& b) {
         return a.similarity > b.similarity;
     });
 
@@ -214,28 +794,27 @@ std::vector<MatchSegment> SimilarityCalculator::find_similar_segments(double sim
 }
 
 
-double SimilarityCalculator::calculate_segment_similarity(
-    const std::vector<NoteEvent>& ref_seg,
-    const std::vector<NoteEvent>& perf_seg) 
+template <typename Scoring>
+double BasicSimilarityCalculator<Scoring>::calculate_segment_similarity(
+    int ref_start,
+    int perf_start,
+    int length) const
 {
-    const double base_score_per_note = 5.0;
-    const double rhythm_match_bonus = 2.0;
-    const double rhythm_tolerance = 0.15;
+    // Scores in place straight from the duration columns.
+    const double* ref_durations = ref_notes.duration + ref_start;
+    const double* perf_durations = perf_notes.duration.data() + perf_start;
     int rhythm_matches = 0;
 
-    for (size_t i = 0; i < ref_seg.size(); ++i) {
-        double ref_duration = ref_seg[i].note_value;
-        double perf_duration = perf_seg[i].note_value;
-        double duration_diff = std::abs(ref_duration - perf_duration);
-        double allowed_diff = ref_duration * rhythm_tolerance;
-        
-        if (duration_diff <= allowed_diff) {
+    for (int i = 0; i < length; ++i) {
+        if (durations_match(ref_durations[i], perf_durations[i])) {
             rhythm_matches++;
         }
     }
 
-    double length_score = base_score_per_note * ref_seg.size();
-    double rhythm_score = rhythm_match_bonus * rhythm_matches;
-    double total_score = length_score + rhythm_score;
-    return std::min(total_score, 100.0);
+    return segment_score(length, rhythm_matches);
 }
+
+
+template class BasicSimilarityCalculator<SegmentScoring::Standard>;
+template class BasicSimilarityCalculator<SegmentScoring::StrictRhythm>;
+template class BasicSimilarityCalculator<SegmentScoring::Lenient>;
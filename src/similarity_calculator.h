@@ -1,6 +1,12 @@
 #pragma once
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include "common_defs.h" 
+#include "note_sequence.h"
+#include "segment_scoring.h"
+
+class ReferenceIndex;
 
 struct MatchSegment {
     int ref_start;
@@ -10,25 +16,148 @@ struct MatchSegment {
     double dtw_score;
 };
 
-class SimilarityCalculator {
+// Which exact interval runs become candidates. AllPrefixes emits every
+// prefix of a run (one per DP cell); the maximal modes emit each run once
+// at its full extent, optionally with its shortest full-scoring prefix.
+enum class CandidateMode {
+    AllPrefixes,
+    MaximalRuns,
+    MaximalRunsWithBestWindow
+};
+
+// How exact interval runs are found. DiagonalDP walks every cell of the
+// ref x perf table; SuffixArray enumerates maximal runs from a generalized
+// suffix array and stays near-linear for long, dissimilar sequences;
+// SeedAndExtend hashes interval 4-grams and extends the hits, so its cost
+// follows the number of real matches; WavefrontDP runs the DP in tiles on
+// every core, one anti-diagonal of tiles at a time, for single huge pairs.
+enum class MatchEngine {
+    DiagonalDP,
+    SuffixArray,
+    SeedAndExtend,
+    WavefrontDP
+};
+
+// What runs when no exact candidate reaches the profile's fallback trigger
+// (90% for Standard). DurationSearch is the interval-plus-duration walk over
+// the performance; ApproximateIntervals looks up performance windows in the
+// reference allowing up to max_edits substituted, inserted or deleted
+// intervals (bit-parallel, 64 per word), and scores each hit along its edit
+// alignment so only notes joined by matching intervals count. max_edits
+// counts intervals, not notes: one wrong pitch changes the intervals on both
+// sides of it and costs two, so the default of 2 tolerates one slip per
+// window.
+enum class FallbackStrategy {
+    DurationSearch,
+    ApproximateIntervals
+};
+
+// Scoring is a SegmentScoring profile. Its constants are compile-time, so
+// each instantiation scores with them inlined; the prebuilt instantiations
+// are Standard, StrictRhythm and Lenient.
+//
+// The reference is read in place, never copied: `ref` must outlive the
+// calculator, so one parsed or mapped reference can serve many performances.
+template <typename Scoring>
+class BasicSimilarityCalculator {
 public:
-    SimilarityCalculator(
-        const std::vector<NoteEvent>& ref,
-        const std::vector<NoteEvent>& perf
+    BasicSimilarityCalculator(
+        const NoteSequence& ref,
+        const NoteSequence& perf,
+        CandidateMode mode = CandidateMode::AllPrefixes,
+        MatchEngine engine = MatchEngine::DiagonalDP,
+        FallbackStrategy fallback = FallbackStrategy::DurationSearch,
+        int max_edits = 2
     );
+    // Takes the reference from a prebuilt index; the SuffixArray engine then
+    // reuses the stored suffix array.
+    BasicSimilarityCalculator(
+        const ReferenceIndex& ref,
+        const NoteSequence& perf,
+        CandidateMode mode = CandidateMode::AllPrefixes,
+        MatchEngine engine = MatchEngine::DiagonalDP,
+        FallbackStrategy fallback = FallbackStrategy::DurationSearch,
+        int max_edits = 2
+    );
+    // A temporary reference would dangle.
+    BasicSimilarityCalculator(NoteSequence&& ref, const NoteSequence& perf,
+                              CandidateMode = CandidateMode::AllPrefixes,
+                              MatchEngine = MatchEngine::DiagonalDP,
+                              FallbackStrategy = FallbackStrategy::DurationSearch,
+                              int = 2) = delete;
+    BasicSimilarityCalculator(ReferenceIndex&& ref, const NoteSequence& perf,
+                              CandidateMode = CandidateMode::AllPrefixes,
+                              MatchEngine = MatchEngine::DiagonalDP,
+                              FallbackStrategy = FallbackStrategy::DurationSearch,
+                              int = 2) = delete;
     
+    using SegmentCallback = std::function<void(const MatchSegment&)>;
+
     std::vector<MatchSegment> find_similar_segments(double similarity_threshold);
+    // Also reports each segment to `on_selected` the moment overlap
+    // resolution accepts it (longest first), so export can start before the
+    // final similarity-ordered list is ready.
+    std::vector<MatchSegment> find_similar_segments(double similarity_threshold,
+                                                    const SegmentCallback& on_selected);
+    // Same pipeline, but only the k best non-overlapping candidates (by
+    // similarity, then length) are kept in a bounded heap, so at most k
+    // segments come back. Overlaps are resolved on admission: a candidate
+    // sharing notes with kept ones replaces them only if it ranks above all
+    // of them, so nested prefixes of one run never crowd out disjoint
+    // matches. Runs whose best possible score cannot enter the full heap
+    // are skipped unscored.
+    std::vector<MatchSegment> find_top_segments(size_t k, double similarity_threshold);
     bool was_fallback_used() const;
 
 private:
-    std::vector<NoteEvent> ref_notes;
-    std::vector<NoteEvent> perf_notes;
-    std::vector<int> ref_intervals;
+    static constexpr int min_exact_run = Scoring::min_exact_run;
+    static constexpr double rhythm_tolerance = Scoring::rhythm_tolerance;
+
+    static bool durations_match(double ref_value, double perf_value) {
+        return SegmentScoring::durations_match<Scoring>(ref_value, perf_value);
+    }
+    static double segment_score(size_t note_count, int rhythm_matches) {
+        return SegmentScoring::segment_score<Scoring>(note_count, rhythm_matches);
+    }
+
+    // Views of the caller's sequence or of the mapped index, refreshed by
+    // compute_intervals() so copies of the calculator stay valid.
+    const NoteSequence* ref_sequence = nullptr;
+    const ReferenceIndex* ref_index = nullptr;
+    NoteColumns ref_notes;
+    IntervalView ref_intervals;
+    std::vector<int> ref_interval_storage;
+    NoteSequence perf_notes;
     std::vector<int> perf_intervals;
+    CandidateMode candidate_mode;
+    MatchEngine match_engine;
+    FallbackStrategy fallback_strategy;
+    int max_edits;
     bool fallback_used = false;
+    size_t top_k = 0;
 
     void compute_intervals();
+    void collect_exact_candidates(std::vector<MatchSegment>& candidates, double similarity_threshold);
+    void collect_diagonal_candidates(std::vector<MatchSegment>& candidates,
+                                     const std::vector<int8_t>& ref_packed,
+                                     const std::vector<int8_t>& perf_packed,
+                                     double similarity_threshold);
+    void collect_wavefront_candidates(std::vector<MatchSegment>& candidates, double similarity_threshold);
+    bool may_enter_top_k(const std::vector<MatchSegment>& candidates, const MatchSegment& seg) const;
+    void add_candidate(std::vector<MatchSegment>& candidates, const MatchSegment& seg) const;
+    void emit_run(std::vector<MatchSegment>& candidates, int i, int j, int run, double similarity_threshold);
+    void emit_maximal_run(std::vector<MatchSegment>& candidates, int i, int j, int run, double similarity_threshold);
+    double try_exact_candidate(std::vector<MatchSegment>& candidates, int i, int j, int run, double similarity_threshold);
+    void try_best_window(std::vector<MatchSegment>& candidates, int ref_start, int perf_start, int length, double run_score);
+    std::vector<MatchSegment> select_non_overlapping(const std::vector<MatchSegment>& candidates,
+                                                     const SegmentCallback& on_selected) const;
+    void perform_approximate_check(std::vector<MatchSegment>& candidates, double threshold);
     void perform_fallback_check(std::vector<MatchSegment>& candidates, double threshold, bool use_musical_time);
-    double calculate_segment_similarity(const std::vector<NoteEvent>& ref_seg,
-                                       const std::vector<NoteEvent>& perf_seg);
-};
\ No newline at end of file
+    double calculate_segment_similarity(int ref_start, int perf_start, int length) const;
+};
+
+extern template class BasicSimilarityCalculator<SegmentScoring::Standard>;
+extern template class BasicSimilarityCalculator<SegmentScoring::StrictRhythm>;
+extern template class BasicSimilarityCalculator<SegmentScoring::Lenient>;
+
+using SimilarityCalculator = BasicSimilarityCalculator<SegmentScoring::Standard>;
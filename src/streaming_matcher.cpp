@@ -0,0 +1,65 @@
+#include "streaming_matcher.h"
+#include <algorithm>
+
+template <typename Scoring>
+BasicStreamingMatcher<Scoring>::BasicStreamingMatcher(const NoteSequence& ref, double similarity_threshold)
+    : ref_notes(ref), similarity_threshold(similarity_threshold)
+{
+    std::vector<int> intervals = ref_notes.intervals();
+    for (size_t i = 0; i < intervals.size(); ++i) {
+        ref_positions_by_interval[intervals[i]].push_back(static_cast<int>(i));
+    }
+}
+
+template <typename Scoring>
+void BasicStreamingMatcher<Scoring>::push(const NoteEvent& note, const SegmentCallback& on_segment) {
+    const auto started = std::chrono::steady_clock::now();
+    next_runs.clear();
+    const size_t index = seen++;
+
+    if (index >= 1) {
+        const int j = static_cast<int>(index) - 1;
+        const int interval = note.pitch - previous_pitch;
+
+        auto positions = ref_positions_by_interval.find(interval);
+        if (positions != ref_positions_by_interval.end()) {
+            for (int i : positions->second) {
+                // Extend the run that ended one cell up the diagonal, or open
+                // a new one covering notes (i, i + 1) and (j, j + 1).
+                ActiveRun current;
+                auto up = active_runs.find(i - 1);
+                if (up != active_runs.end()) {
+                    current = up->second;
+                    ++current.run;
+                } else {
+                    current = {1, 0};
+                    if (SegmentScoring::durations_match<Scoring>(ref_notes.duration[i], previous_duration)) {
+                        ++current.rhythm_matches;
+                    }
+                }
+                if (SegmentScoring::durations_match<Scoring>(ref_notes.duration[i + 1], note.note_value)) {
+                    ++current.rhythm_matches;
+                }
+                next_runs[i] = current;
+
+                if (current.run < Scoring::min_exact_run) continue;
+                const int length = current.run + 1;
+                double sim = SegmentScoring::segment_score<Scoring>(length, current.rhythm_matches);
+                if (sim >= similarity_threshold && on_segment) {
+                    on_segment({i - current.run + 1, j - current.run + 1, length, sim, 0.0});
+                }
+            }
+        }
+    }
+    active_runs.swap(next_runs);
+    previous_pitch = note.pitch;
+    previous_duration = note.note_value;
+
+    last_push_latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - started);
+    max_push_latency = std::max(max_push_latency, last_push_latency);
+}
+
+template class BasicStreamingMatcher<SegmentScoring::Standard>;
+template class BasicStreamingMatcher<SegmentScoring::StrictRhythm>;
+template class BasicStreamingMatcher<SegmentScoring::Lenient>;
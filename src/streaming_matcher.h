@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "common_defs.h"
+#include "note_sequence.h"
+#include "segment_scoring.h"
+#include "similarity_calculator.h"
+
+// Scores a performance while it is being played. Notes are pushed one at a
+// time; only the exact interval runs that end at the newest note are kept,
+// so a push touches just the reference positions sharing the new interval.
+// Of the performance itself only the previous note is kept. A segment is
+// reported when its run first reaches the threshold and again each time a
+// later note extends it; updates of one segment share its ref_start and
+// perf_start. Segments are not resolved against each other.
+//
+// Scoring is a SegmentScoring profile, as for BasicSimilarityCalculator.
+template <typename Scoring>
+class BasicStreamingMatcher {
+public:
+    using SegmentCallback = std::function<void(const MatchSegment&)>;
+
+    BasicStreamingMatcher(const NoteSequence& ref, double similarity_threshold);
+
+    // Adds the next performance note (with its final duration) and reports
+    // every segment that now ends at it and scores above the threshold.
+    void push(const NoteEvent& note, const SegmentCallback& on_segment);
+
+    size_t notes_seen() const { return seen; }
+    std::chrono::nanoseconds last_latency() const { return last_push_latency; }
+    std::chrono::nanoseconds max_latency() const { return max_push_latency; }
+
+private:
+    // An exact run ending at a reference interval and the newest
+    // performance interval; rhythm_matches counts its run + 1 note pairs.
+    struct ActiveRun {
+        int run;
+        int rhythm_matches;
+    };
+
+    NoteSequence ref_notes;
+    std::unordered_map<int, std::vector<int>> ref_positions_by_interval;
+    std::unordered_map<int, ActiveRun> active_runs;
+    std::unordered_map<int, ActiveRun> next_runs;
+    double similarity_threshold;
+    size_t seen = 0;
+    int previous_pitch = 0;
+    double previous_duration = 0.0;
+    std::chrono::nanoseconds last_push_latency{0};
+    std::chrono::nanoseconds max_push_latency{0};
+};
+
+extern template class BasicStreamingMatcher<SegmentScoring::Standard>;
+extern template class BasicStreamingMatcher<SegmentScoring::StrictRhythm>;
+extern template class BasicStreamingMatcher<SegmentScoring::Lenient>;
+
+using StreamingMatcher = BasicStreamingMatcher<SegmentScoring::Standard>;
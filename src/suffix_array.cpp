@@ -0,0 +1,244 @@
+#include "suffix_array.h"
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+    // Left-context key of a suffix that starts a sequence. It never blocks a
+    // pair from being left-maximal, even when paired with itself.
+    constexpr int boundary_key = 0;
+
+    struct Occurrences {
+        std::vector<int> a_pos;
+        std::vector<int> b_pos;
+    };
+
+    // Suffix positions of one union-find block, grouped by the value just
+    // before each suffix so that pairs sharing it can be skipped wholesale.
+    using Block = std::unordered_map<int, Occurrences>;
+
+    int find_root(std::vector<int>& parent, int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    void emit_pairs(const Occurrences& left, const Occurrences& right, int length,
+                    std::vector<ExactRun>& runs) {
+        for (int a : left.a_pos) {
+            for (int b : right.b_pos) {
+                runs.push_back({a, b, length});
+            }
+        }
+        for (int a : right.a_pos) {
+            for (int b : left.b_pos) {
+                runs.push_back({a, b, length});
+            }
+        }
+    }
+}
+
+namespace SuffixArray {
+    std::vector<int> build(const std::vector<int>& text, int alphabet_size) {
+        const int n = text.size();
+        std::vector<int> sa(n), rank(text), tmp(n);
+        if (n == 0) return sa;
+
+        // Prefix doubling with a counting sort on each pass: O(n log n).
+        int classes = alphabet_size;
+        std::iota(sa.begin(), sa.end(), 0);
+        std::vector<int> count(std::max(classes, n) + 1);
+        for (int k = 0; ; k = (k == 0) ? 1 : k * 2) {
+            // Order by the second key first: suffixes with no second half,
+            // then the rest in the order of the previous pass.
+            int p = 0;
+            if (k == 0) {
+                std::iota(tmp.begin(), tmp.end(), 0);
+                p = n;
+            } else {
+                for (int i = n - k; i < n; ++i) tmp[p++] = i;
+                for (int i = 0; i < n; ++i) {
+                    if (sa[i] >= k) tmp[p++] = sa[i] - k;
+                }
+            }
+
+            std::fill(count.begin(), count.begin() + classes + 1, 0);
+            for (int i = 0; i < n; ++i) ++count[rank[i] + 1];
+            for (int c = 1; c <= classes; ++c) count[c] += count[c - 1];
+            for (int i = 0; i < n; ++i) sa[count[rank[tmp[i]]]++] = tmp[i];
+
+            auto second = [&](int i) { return (k > 0 && i + k < n) ? rank[i + k] : -1; };
+            tmp[sa[0]] = 0;
+            for (int i = 1; i < n; ++i) {
+                bool same = rank[sa[i]] == rank[sa[i - 1]] &&
+                            second(sa[i]) == second(sa[i - 1]);
+                tmp[sa[i]] = tmp[sa[i - 1]] + (same ? 0 : 1);
+            }
+            rank.swap(tmp);
+            classes = rank[sa[n - 1]] + 1;
+            if (classes == n) break;
+            if (k >= n) break;
+        }
+        return sa;
+    }
+
+    std::vector<int> build_from_values(const std::vector<int>& values) {
+        std::vector<int> sorted(values);
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        std::vector<int> text;
+        text.reserve(values.size());
+        for (int v : values) {
+            text.push_back(static_cast<int>(std::lower_bound(sorted.begin(), sorted.end(), v) - sorted.begin()));
+        }
+        return build(text, std::max<int>(1, sorted.size()));
+    }
+
+    std::vector<int> build_lcp(const std::vector<int>& text, const std::vector<int>& sa) {
+        const int n = text.size();
+        std::vector<int> lcp(n, 0), rank(n);
+        for (int i = 0; i < n; ++i) rank[sa[i]] = i;
+
+        // Kasai et al.: the LCP drops by at most one between text positions.
+        int h = 0;
+        for (int i = 0; i < n; ++i) {
+            if (rank[i] == 0) {
+                h = 0;
+                continue;
+            }
+            int j = sa[rank[i] - 1];
+            while (i + h < n && j + h < n && text[i + h] == text[j + h]) ++h;
+            lcp[rank[i]] = h;
+            if (h > 0) --h;
+        }
+        return lcp;
+    }
+
+    std::vector<ExactRun> maximal_common_runs(const std::vector<int>& a,
+                                              const std::vector<int>& b,
+                                              int min_length) {
+        std::vector<ExactRun> runs;
+        const int n = a.size();
+        const int m = b.size();
+        if (n == 0 || m == 0 || min_length < 1) return runs;
+
+        // Map values to dense ranks starting at 1 (0 is the boundary key) and
+        // join the sequences with two unique separators, so no common prefix
+        // can cross from one sequence into the other.
+        std::vector<int> values(a);
+        values.insert(values.end(), b.begin(), b.end());
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        const int sigma = values.size();
+        auto dense = [&](int v) {
+            return static_cast<int>(std::lower_bound(values.begin(), values.end(), v) - values.begin()) + 1;
+        };
+
+        std::vector<int> text;
+        text.reserve(n + m + 2);
+        for (int v : a) text.push_back(dense(v));
+        text.push_back(sigma + 1);
+        for (int v : b) text.push_back(dense(v));
+        text.push_back(sigma + 2);
+
+        std::vector<int> sa = build(text, sigma + 3);
+        std::vector<int> lcp = build_lcp(text, sa);
+
+        // Merging adjacent suffix-array blocks in decreasing LCP order means
+        // every pair that first meets at lcp[i] shares exactly lcp[i] values,
+        // which makes it right-maximal. Pairs whose preceding values differ
+        // are also left-maximal and are reported.
+        std::vector<int> order;
+        for (int i = 1; i < static_cast<int>(lcp.size()); ++i) {
+            if (lcp[i] >= min_length) order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(),
+            [&](int x, int y) { return lcp[x] > lcp[y]; });
+
+        std::vector<int> parent(sa.size());
+        std::iota(parent.begin(), parent.end(), 0);
+        std::unordered_map<int, Block> blocks;
+        std::unordered_map<int, int> block_size;
+        auto block_of = [&](int root) -> Block& {
+            auto it = blocks.find(root);
+            if (it != blocks.end()) return it->second;
+            Block& block = blocks[root];
+            int pos = sa[root];
+            if (pos < n) {
+                block[pos == 0 ? boundary_key : text[pos - 1]].a_pos.push_back(pos);
+            } else {
+                int q = pos - n - 1;
+                block[q == 0 ? boundary_key : text[pos - 1]].b_pos.push_back(q);
+            }
+            block_size[root] = 1;
+            return block;
+        };
+
+        for (int i : order) {
+            int left = find_root(parent, i - 1);
+            int right = find_root(parent, i);
+            Block& lb = block_of(left);
+            Block& rb = block_of(right);
+
+            for (const auto& [lkey, locc] : lb) {
+                for (const auto& [rkey, rocc] : rb) {
+                    if (lkey != rkey || lkey == boundary_key) {
+                        emit_pairs(locc, rocc, lcp[i], runs);
+                    }
+                }
+            }
+
+            // Fold the smaller block into the larger one.
+            if (block_size[left] < block_size[right]) std::swap(left, right);
+            Block& big = blocks[left];
+            for (auto& [key, occ] : blocks[right]) {
+                Occurrences& dst = big[key];
+                dst.a_pos.insert(dst.a_pos.end(), occ.a_pos.begin(), occ.a_pos.end());
+                dst.b_pos.insert(dst.b_pos.end(), occ.b_pos.begin(), occ.b_pos.end());
+            }
+            block_size[left] += block_size[right];
+            blocks.erase(right);
+            block_size.erase(right);
+            parent[right] = left;
+        }
+        return runs;
+    }
+
+    std::vector<ExactRun> maximal_common_runs(const int* a, int n, const int* a_sa,
+                                              const std::vector<int>& b,
+                                              int min_length) {
+        std::vector<ExactRun> runs;
+        const int m = b.size();
+        if (n == 0 || m < min_length || min_length < 1) return runs;
+
+        // Compares the first min_length values of suffix a[p..] with b[q..];
+        // a suffix that ends early sorts first.
+        auto compare_seed = [&](int p, int q) {
+            for (int t = 0; t < min_length; ++t) {
+                if (p + t == n) return -1;
+                if (a[p + t] != b[q + t]) return a[p + t] < b[q + t] ? -1 : 1;
+            }
+            return 0;
+        };
+
+        for (int q = 0; q + min_length <= m; ++q) {
+            const int* lo = std::partition_point(a_sa, a_sa + n,
+                [&](int p) { return compare_seed(p, q) < 0; });
+            const int* hi = std::partition_point(lo, a_sa + n,
+                [&](int p) { return compare_seed(p, q) == 0; });
+
+            for (const int* it = lo; it != hi; ++it) {
+                int p = *it;
+                if (p > 0 && q > 0 && a[p - 1] == b[q - 1]) continue;
+                int length = min_length;
+                while (p + length < n && q + length < m && a[p + length] == b[q + length]) {
+                    ++length;
+                }
+                runs.push_back({p, q, length});
+            }
+        }
+        return runs;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+
+// A common run of equal values between two integer sequences: a[a_start + k]
+// == b[b_start + k] for 0 <= k < length.
+struct ExactRun {
+    int a_start;
+    int b_start;
+    int length;
+};
+
+namespace SuffixArray {
+    // Suffix array of `text`, whose values must lie in [0, alphabet_size).
+    std::vector<int> build(const std::vector<int>& text, int alphabet_size);
+
+    // Suffix array of arbitrary integer values, ordered lexicographically
+    // with a proper prefix sorting before its extensions.
+    std::vector<int> build_from_values(const std::vector<int>& values);
+
+    // lcp[i] is the longest common prefix of suffixes sa[i - 1] and sa[i];
+    // lcp[0] is 0.
+    std::vector<int> build_lcp(const std::vector<int>& text, const std::vector<int>& sa);
+
+    // Every run of at least `min_length` values shared by `a` and `b` that
+    // cannot be extended on either side, found from the generalized suffix
+    // array of a + b.
+    std::vector<ExactRun> maximal_common_runs(const std::vector<int>& a,
+                                              const std::vector<int>& b,
+                                              int min_length);
+
+    // Same runs, using a suffix array of `a` built ahead of time (see
+    // build_from_values). Each suffix of `b` is located by bisection, so only
+    // `b` is scanned per query.
+    std::vector<ExactRun> maximal_common_runs(const int* a, int n, const int* a_sa,
+                                              const std::vector<int>& b,
+                                              int min_length);
+}
@@ -0,0 +1,91 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t target = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        ++queued;
+        ++pending;
+    }
+    work_available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    all_done.wait(lock, [this] { return pending == 0; });
+}
+
+bool ThreadPool::try_take(size_t self, std::function<void()>& task) {
+    {
+        TaskQueue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        TaskQueue& victim = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(size_t self) {
+    std::function<void()> task;
+    while (true) {
+        if (try_take(self, task)) {
+            {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                --queued;
+            }
+            task();
+            task = nullptr;
+            std::lock_guard<std::mutex> lock(state_mutex);
+            if (--pending == 0) {
+                all_done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(state_mutex);
+        work_available.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued <= 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool with one task deque per worker. A worker takes its own
+// newest task first and, when its deque runs dry, steals the oldest task
+// from another worker, so uneven jobs (short and long MIDI files) still
+// keep every core busy.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Tasks must not throw; catch and report inside the task instead.
+    void submit(std::function<void()> task);
+    // Blocks until every submitted task has finished.
+    void wait();
+    size_t size() const { return threads.size(); }
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next_queue{0};
+
+    std::mutex state_mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    long queued = 0;
+    long pending = 0;
+    bool stopping = false;
+
+    bool try_take(size_t self, std::function<void()>& task);
+    void worker_loop(size_t self);
+};
@@ -0,0 +1,58 @@
+#include "trace.h"
+#include <atomic>
+#include <iostream>
+
+namespace {
+    std::atomic<int> max_level{static_cast<int>(TraceLevel::Info)};
+    std::atomic<bool> category_enabled[static_cast<int>(TraceCategory::Count)] = {
+        {true}, {true}, {true}, {true}
+    };
+
+    std::mutex sink_mutex;
+    std::shared_ptr<TraceSink> current_sink = std::make_shared<StdoutTraceSink>();
+}
+
+void StdoutTraceSink::write(TraceCategory, TraceLevel, const std::string& message) {
+    std::cout << message << "\n";
+}
+
+RingBufferTraceSink::RingBufferTraceSink(size_t capacity) : capacity(capacity) {}
+
+void RingBufferTraceSink::write(TraceCategory, TraceLevel, const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (capacity == 0) return;
+    if (lines.size() == capacity) {
+        lines.pop_front();
+    }
+    lines.push_back(message);
+}
+
+std::vector<std::string> RingBufferTraceSink::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::vector<std::string>(lines.begin(), lines.end());
+}
+
+namespace Trace {
+    bool enabled(TraceCategory category, TraceLevel level) {
+        return static_cast<int>(level) <= max_level.load(std::memory_order_relaxed) &&
+               category_enabled[static_cast<int>(category)].load(std::memory_order_relaxed);
+    }
+
+    void set_level(TraceLevel level) {
+        max_level.store(static_cast<int>(level));
+    }
+
+    void set_category_enabled(TraceCategory category, bool enabled) {
+        category_enabled[static_cast<int>(category)].store(enabled);
+    }
+
+    void set_sink(std::shared_ptr<TraceSink> sink) {
+        std::lock_guard<std::mutex> lock(sink_mutex);
+        current_sink = sink ? std::move(sink) : std::make_shared<StdoutTraceSink>();
+    }
+
+    void write(TraceCategory category, TraceLevel level, const std::string& message) {
+        std::lock_guard<std::mutex> lock(sink_mutex);
+        current_sink->write(category, level, message);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Diagnostic tracing. Every NNOTE_TRACE statement compiles to nothing unless
+// the build defines NNOTE_ENABLE_TRACE, so trace points may sit inside hot
+// loops. When compiled in, messages are filtered at runtime by level and
+// category and handed to the installed sink (stdout by default).
+
+enum class TraceLevel {
+    Error,
+    Info,
+    Debug
+};
+
+enum class TraceCategory {
+    Parse,
+    Match,
+    Fallback,
+    Export,
+    Count
+};
+
+class TraceSink {
+public:
+    virtual ~TraceSink() = default;
+    virtual void write(TraceCategory category, TraceLevel level, const std::string& message) = 0;
+};
+
+class StdoutTraceSink : public TraceSink {
+public:
+    void write(TraceCategory category, TraceLevel level, const std::string& message) override;
+};
+
+// Keeps only the most recent `capacity` messages in memory.
+class RingBufferTraceSink : public TraceSink {
+public:
+    explicit RingBufferTraceSink(size_t capacity);
+
+    void write(TraceCategory category, TraceLevel level, const std::string& message) override;
+    std::vector<std::string> snapshot() const;
+
+private:
+    size_t capacity;
+    mutable std::mutex mutex;
+    std::deque<std::string> lines;
+};
+
+namespace Trace {
+    bool enabled(TraceCategory category, TraceLevel level);
+    void set_level(TraceLevel level);
+    void set_category_enabled(TraceCategory category, bool enabled);
+    void set_sink(std::shared_ptr<TraceSink> sink);
+    void write(TraceCategory category, TraceLevel level, const std::string& message);
+}
+
+#ifdef NNOTE_ENABLE_TRACE
+#define NNOTE_TRACE(category, level, expr)                          \
+    do {                                                            \
+        if (Trace::enabled((category), (level))) {                  \
+            std::ostringstream nnote_trace_stream;                  \
+            nnote_trace_stream << expr;                             \
+            Trace::write((category), (level), nnote_trace_stream.str()); \
+        }                                                           \
+    } while (0)
+#else
+#define NNOTE_TRACE(category, level, expr) do { } while (0)
+#endif
@@ -0,0 +1,154 @@
+// Checks the ApproximateIntervals fallback on performances that drop or add
+// a note close to the end of the reference, where the reported segment used
+// to be shifted off the match and rhythm compared across the edit, and on a
+// passage with wrong notes played between unrelated notes.
+//
+//   nnote-test-approximate    (exit status 0 on success)
+#include "similarity_calculator.h"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const std::string& what) {
+        if (!condition) {
+            std::cerr << "[Test Error] " << what << "\n";
+            ++failures;
+        }
+    }
+
+    // 30 notes with pitch intervals that do not repeat, so a performance
+    // window matches in exactly one place, and durations that differ from
+    // their neighbours, so rhythm compared one note off never agrees.
+    std::vector<NoteEvent> make_reference() {
+        std::mt19937 rng(7);
+        std::vector<NoteEvent> notes;
+        const double values[] = {0.25, 0.5, 1.0, 2.0};
+        double start = 0.0;
+        int pitch = 60;
+        for (int i = 0; i < 30; ++i) {
+            pitch = 40 + (pitch - 40 + 7 + static_cast<int>(rng() % 23)) % 50;
+            double value = values[i % 4];
+            notes.push_back({start, pitch, value, 120.0, 0});
+            start += value * 0.5;
+        }
+        return notes;
+    }
+
+    std::vector<MatchSegment> run_fallback(const std::vector<NoteEvent>& ref,
+                                           const std::vector<NoteEvent>& perf,
+                                           bool& fallback_used,
+                                           int max_edits = 2) {
+        const NoteSequence ref_sequence(ref);
+        const NoteSequence perf_sequence(perf);
+        SimilarityCalculator calculator(ref_sequence, perf_sequence, CandidateMode::AllPrefixes,
+                                        MatchEngine::DiagonalDP, FallbackStrategy::ApproximateIntervals,
+                                        max_edits);
+        auto segments = calculator.find_similar_segments(60.0);
+        fallback_used = calculator.was_fallback_used();
+        return segments;
+    }
+
+    // The performance plays reference notes 18..29 but skips note 27.
+    void deletion_near_end() {
+        const auto ref = make_reference();
+        std::vector<NoteEvent> perf(ref.begin() + 18, ref.end());
+        perf.erase(perf.begin() + 9);
+
+        bool fallback_used = false;
+        const auto segments = run_fallback(ref, perf, fallback_used);
+        check(fallback_used, "deletion: fallback not triggered");
+        check(!segments.empty(), "deletion: no segment found");
+        if (segments.empty()) return;
+
+        const MatchSegment& seg = segments.front();
+        check(seg.ref_start == 18, "deletion: ref_start " + std::to_string(seg.ref_start) + ", expected 18");
+        check(seg.perf_start == 0, "deletion: perf_start " + std::to_string(seg.perf_start) + ", expected 0");
+        // Reference span 18..29 (12 notes), performance span 11 notes.
+        check(seg.length == 11, "deletion: length " + std::to_string(seg.length) + ", expected 11");
+        // Notes 18..26 and 29 are joined by matching intervals and keep their
+        // durations: 10 notes, 10 rhythm matches.
+        check(seg.similarity == SegmentScoring::segment_score(10, 10),
+              "deletion: similarity " + std::to_string(seg.similarity));
+    }
+
+    // The performance plays reference notes 18..29 with an extra note after 27.
+    void insertion_near_end() {
+        const auto ref = make_reference();
+        std::vector<NoteEvent> perf(ref.begin() + 18, ref.end());
+        NoteEvent extra = perf[9];
+        extra.pitch += 13;
+        extra.note_value = 3.0;
+        perf.insert(perf.begin() + 10, extra);
+
+        bool fallback_used = false;
+        const auto segments = run_fallback(ref, perf, fallback_used);
+        check(fallback_used, "insertion: fallback not triggered");
+        check(!segments.empty(), "insertion: no segment found");
+        if (segments.empty()) return;
+
+        // The match ends on the last reference note, so a 13-note window
+        // would not fit; the segment must still start where the match does.
+        const MatchSegment& seg = segments.front();
+        check(seg.ref_start == 18, "insertion: ref_start " + std::to_string(seg.ref_start) + ", expected 18");
+        check(seg.perf_start == 0, "insertion: perf_start " + std::to_string(seg.perf_start) + ", expected 0");
+        check(seg.length == 12, "insertion: length " + std::to_string(seg.length) + ", expected 12");
+        check(seg.ref_start + seg.length <= static_cast<int>(ref.size()), "insertion: segment past reference end");
+        // Notes 18..27 and 29 pair up; 28 follows the inserted note.
+        check(seg.similarity == SegmentScoring::segment_score(11, 11),
+              "insertion: similarity " + std::to_string(seg.similarity));
+    }
+
+    // Random pitches and a duration no reference note has.
+    std::vector<NoteEvent> make_noise(int count, double start, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::vector<NoteEvent> notes;
+        for (int i = 0; i < count; ++i) {
+            notes.push_back({start, 30 + static_cast<int>(rng() % 70), 0.75, 120.0, 0});
+            start += 0.375;
+        }
+        return notes;
+    }
+
+    // Reference notes 8..21 with notes 12 and 17 a semitone off, between 30
+    // unrelated notes before and 10 after. Each slip costs two interval
+    // edits, so four are allowed.
+    void slips_between_noise() {
+        const auto ref = make_reference();
+        std::vector<NoteEvent> perf = make_noise(30, 0.0, 11);
+        std::vector<NoteEvent> passage(ref.begin() + 8, ref.begin() + 22);
+        passage[4].pitch += 1;
+        passage[9].pitch -= 1;
+        perf.insert(perf.end(), passage.begin(), passage.end());
+        const auto tail = make_noise(10, 100.0, 12);
+        perf.insert(perf.end(), tail.begin(), tail.end());
+
+        bool fallback_used = false;
+        const auto segments = run_fallback(ref, perf, fallback_used, 4);
+        check(fallback_used, "noise: fallback not triggered");
+        check(!segments.empty(), "noise: no segment found");
+        if (segments.empty()) return;
+
+        const MatchSegment& seg = segments.front();
+        check(seg.ref_start == 8, "noise: ref_start " + std::to_string(seg.ref_start) + ", expected 8");
+        check(seg.perf_start == 30, "noise: perf_start " + std::to_string(seg.perf_start) + ", expected 30");
+        check(seg.length == 14, "noise: length " + std::to_string(seg.length) + ", expected 14");
+        // The four intervals touching the slips do not match: 10 notes pair
+        // up, all with their durations.
+        check(seg.similarity == SegmentScoring::segment_score(10, 10),
+              "noise: similarity " + std::to_string(seg.similarity));
+    }
+}
+
+int main() {
+    deletion_near_end();
+    insertion_near_end();
+    slips_between_noise();
+    if (failures == 0) {
+        std::cout << "[Test] approximate fallback: all checks passed\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+// Checks find_top_segments on a performance that plays one long passage of
+// the reference and three short ones elsewhere, where the nested prefixes of
+// the long run used to fill every top-K slot and leave one segment after
+// overlap resolution.
+//
+//   nnote-test-top-segments    (exit status 0 on success)
+#include "similarity_calculator.h"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const std::string& what) {
+        if (!condition) {
+            std::cerr << "[Test Error] " << what << "\n";
+            ++failures;
+        }
+    }
+
+    // 120 notes of a wide random walk, so short interval runs do not repeat.
+    std::vector<NoteEvent> make_reference() {
+        std::mt19937 rng(7);
+        std::vector<NoteEvent> notes;
+        const double values[] = {0.25, 0.5, 1.0, 2.0};
+        double start = 0.0;
+        int pitch = 60;
+        for (int i = 0; i < 120; ++i) {
+            pitch = 40 + (pitch - 40 + 7 + static_cast<int>(rng() % 23)) % 50;
+            double value = values[i % 4];
+            notes.push_back({start, pitch, value, 120.0, 0});
+            start += value * 0.5;
+        }
+        return notes;
+    }
+
+    // Reference notes 0..59, then 70..79, 85..94 and 100..109, each short
+    // copy after five notes outside the reference's pitch range.
+    std::vector<NoteEvent> make_performance(const std::vector<NoteEvent>& ref) {
+        std::vector<NoteEvent> perf(ref.begin(), ref.begin() + 60);
+        for (int start : {70, 85, 100}) {
+            int filler = 100;
+            for (int k = 0; k < 5; ++k) {
+                perf.push_back({0.0, filler, 3.0, 120.0, 0});
+                filler += (k % 2 == 0) ? 9 : -4;
+            }
+            perf.insert(perf.end(), ref.begin() + start, ref.begin() + start + 10);
+        }
+        return perf;
+    }
+
+    void top_three(CandidateMode mode, const std::string& label) {
+        const auto ref = make_reference();
+        const auto perf = make_performance(ref);
+        const NoteSequence ref_sequence(ref);
+        const NoteSequence perf_sequence(perf);
+        SimilarityCalculator calculator(ref_sequence, perf_sequence, mode);
+
+        const auto all = calculator.find_similar_segments(70.0);
+        check(all.size() == 4, label + ": find_similar_segments returned " + std::to_string(all.size()) +
+              " segments, expected 4");
+
+        const auto top = calculator.find_top_segments(3, 70.0);
+        check(top.size() == 3, label + ": find_top_segments returned " + std::to_string(top.size()) +
+              " segments, expected 3");
+        if (top.size() != 3) return;
+
+        // The long passage scores 100; the short copies tie at 70 and are
+        // kept in reference order.
+        const int expected_ref[] = {0, 70, 85};
+        const int expected_perf[] = {0, 65, 80};
+        const int expected_length[] = {60, 10, 10};
+        for (int i = 0; i < 3; ++i) {
+            const std::string where = label + ": segment " + std::to_string(i);
+            check(top[i].ref_start == expected_ref[i],
+                  where + " ref_start " + std::to_string(top[i].ref_start));
+            check(top[i].perf_start == expected_perf[i],
+                  where + " perf_start " + std::to_string(top[i].perf_start));
+            check(top[i].length == expected_length[i],
+                  where + " length " + std::to_string(top[i].length));
+        }
+    }
+}
+
+int main() {
+    top_three(CandidateMode::AllPrefixes, "all prefixes");
+    top_three(CandidateMode::MaximalRuns, "maximal runs");
+    if (failures == 0) {
+        std::cout << "[Test] top segments: all checks passed\n";
+    }
+    return failures == 0 ? 0 : 1;
+}